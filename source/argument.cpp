@@ -4,6 +4,7 @@
 
 #include <iostream>
 #include <vector>
+#include <string_view>
 
 #include "strutil.hpp"
 using namespace std::string_literals;
@@ -12,12 +13,12 @@ using namespace std::string_literals;
 argument_t::argument_t(int argc,const char * argv[]) {
     
     for (auto i = 1 ; i<argc;i++){
-        auto value = std::string(argv[i]);
+        auto value = std::string_view(argv[i]);
         if (value.find("--")== 0){
             if (value.size()>2){
-                value = value.substr(2) ;
-                auto [key,keyvalue] = strutil::split(value,"=");
-                flags.push_back(std::make_pair(strutil::lower(key), keyvalue)) ;
+                value.remove_prefix(2) ;
+                auto [key,keyvalue] = strutil::split_view(value,"=");
+                flags.push_back(std::make_pair(strutil::lower(std::string(key)), std::string(keyvalue))) ;
            }
         }
         else {
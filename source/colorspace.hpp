@@ -0,0 +1,106 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#ifndef colorspace_hpp
+#define colorspace_hpp
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <cmath>
+
+//=======================================================================================================================
+// Conversions from the 5 bit channel (RGB555) hue colors to other color spaces.
+// A channel only has 32 values, so the per channel conversions are lookup tables built at compile time.
+//=======================================================================================================================
+namespace colorspace {
+    //=================================================================================
+    constexpr auto red(std::uint16_t color) ->std::uint16_t {
+        return (color>>10)&0x1f ;
+    }
+    //=================================================================================
+    constexpr auto green(std::uint16_t color) ->std::uint16_t {
+        return (color>>5)&0x1f ;
+    }
+    //=================================================================================
+    constexpr auto blue(std::uint16_t color) ->std::uint16_t {
+        return color&0x1f ;
+    }
+    //=================================================================================
+    // Expands a 5 bit channel to 8 bits, replicating the high bits into the low ones (so 31 maps to 255)
+    constexpr auto expand(std::uint16_t channel) ->std::uint8_t {
+        return static_cast<std::uint8_t>((channel<<3) | (channel>>2)) ;
+    }
+    //=================================================================================
+    // x^(1/5) by newton iteration, so it can be evaluated at compile time
+    constexpr auto root5(double value) ->double {
+        auto rvalue = 1.0 ;
+        if (value <= 0.0){
+            return 0.0 ;
+        }
+        for (auto j = 0 ; j<64;j++){
+            auto squared = rvalue*rvalue ;
+            rvalue = ((4.0*rvalue) + (value/(squared*squared)))/5.0 ;
+        }
+        return rvalue ;
+    }
+    //=================================================================================
+    // sRGB transfer function, decoding a 0-1 value to linear light
+    constexpr auto decode(double value) ->double {
+        if (value <= 0.04045){
+            return value/12.92 ;
+        }
+        // x^2.4 = x^2 * (x^2)^(1/5)
+        auto base = (value+0.055)/1.055 ;
+        auto squared = base*base ;
+        return squared * root5(squared) ;
+    }
+    //=================================================================================
+    constexpr auto makeExpanded() ->std::array<std::uint8_t,32> {
+        auto rvalue = std::array<std::uint8_t,32>() ;
+        for (std::uint16_t j = 0 ; j<32;j++){
+            rvalue[j] = expand(j) ;
+        }
+        return rvalue ;
+    }
+    //=================================================================================
+    constexpr auto makeLinear() ->std::array<float,32> {
+        auto rvalue = std::array<float,32>() ;
+        for (std::uint16_t j = 0 ; j<32;j++){
+            rvalue[j] = static_cast<float>(decode(static_cast<double>(expand(j))/255.0)) ;
+        }
+        return rvalue ;
+    }
+    //=================================================================================
+    // 5 bit channel to 8 bit channel
+    inline constexpr auto rgb888 = makeExpanded() ;
+    // 5 bit channel to linear light (0-1)
+    inline constexpr auto linear = makeLinear() ;
+    
+    //=================================================================================
+    // Relative luminance (0-1) of a color
+    inline auto luminance(std::uint16_t color) ->float {
+        return (0.2126729f*linear[red(color)]) + (0.7151522f*linear[green(color)]) + (0.0721750f*linear[blue(color)]) ;
+    }
+    //=================================================================================
+    // CIELAB (D65) from linear light rgb. Used on whole arrays, so each call converts count values
+    inline auto lab(const float *red,const float *green,const float *blue,float *lightness,float *a,float *b,std::size_t count) ->void {
+        constexpr auto epsilon = 216.0f/24389.0f ;
+        constexpr auto kappa = 24389.0f/27.0f ;
+        auto f = [](float value) {
+            return value > epsilon ? std::cbrt(value) : ((kappa*value)+16.0f)/116.0f ;
+        };
+        for (std::size_t j = 0 ; j<count;j++){
+            auto x = ((0.4124564f*red[j]) + (0.3575761f*green[j]) + (0.1804375f*blue[j]))/0.95047f ;
+            auto y = (0.2126729f*red[j]) + (0.7151522f*green[j]) + (0.0721750f*blue[j]) ;
+            auto z = ((0.0193339f*red[j]) + (0.1191920f*green[j]) + (0.9503041f*blue[j]))/1.08883f ;
+            auto fx = f(x) ;
+            auto fy = f(y) ;
+            auto fz = f(z) ;
+            lightness[j] = (116.0f*fy) - 16.0f ;
+            a[j] = 500.0f*(fx-fy) ;
+            b[j] = 200.0f*(fy-fz) ;
+        }
+    }
+}
+
+#endif /* colorspace_hpp */
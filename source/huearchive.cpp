@@ -0,0 +1,459 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#include "huearchive.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include "huecodec.hpp"
+#include "huejournal.hpp"
+#include "parallel.hpp"
+
+using namespace std::string_literals;
+
+//=======================================================================================================================
+// Bit streams, least significant bit first
+//=======================================================================================================================
+
+//=======================================================================================================================
+class bitwriter_t {
+    std::vector<std::uint8_t> &bytes ;
+    std::uint64_t accumulator ;
+    int used ;
+public:
+    bitwriter_t(std::vector<std::uint8_t> &output):bytes(output),accumulator(0),used(0){}
+    //=================================================================================
+    // Up to 32 bits
+    auto put(std::uint32_t value,int bits) ->void {
+        accumulator |= (std::uint64_t(value) & ((std::uint64_t(1)<<bits)-1)) << used ;
+        used += bits ;
+        while (used >= 8){
+            bytes.push_back(static_cast<std::uint8_t>(accumulator & 0xff));
+            accumulator >>= 8 ;
+            used -= 8 ;
+        }
+    }
+    //=================================================================================
+    // value>>k in unary (ones ended by a zero), then the low k bits
+    auto rice(std::uint32_t value,int k) ->void {
+        auto quotient = value>>k ;
+        while (quotient >= 24){
+            put(0xffffff,24);
+            quotient -= 24 ;
+        }
+        put((std::uint32_t(1)<<quotient)-1,static_cast<int>(quotient)+1);
+        put(value,k);
+    }
+    //=================================================================================
+    auto finish() ->void {
+        if (used > 0){
+            bytes.push_back(static_cast<std::uint8_t>(accumulator & 0xff));
+        }
+        accumulator = 0 ;
+        used = 0 ;
+    }
+};
+//=======================================================================================================================
+class bitreader_t {
+    const std::uint8_t *data ;
+    size_t length ;
+    size_t position ;
+    std::uint64_t accumulator ;
+    int available ;
+    auto refill() ->void {
+        while ((available <= 56) && (position < length)){
+            accumulator |= std::uint64_t(data[position++]) << available ;
+            available += 8 ;
+        }
+    }
+public:
+    bitreader_t(const std::uint8_t *bytes,size_t size):data(bytes),length(size),position(0),accumulator(0),available(0){}
+    //=================================================================================
+    auto get(int bits) ->std::uint32_t {
+        if (available < bits){
+            refill();
+            if (available < bits){
+                throw std::runtime_error("Hue archive block is corrupt.");
+            }
+        }
+        auto value = static_cast<std::uint32_t>(accumulator & ((std::uint64_t(1)<<bits)-1)) ;
+        accumulator >>= bits ;
+        available -= bits ;
+        return value ;
+    }
+    //=================================================================================
+    auto rice(int k) ->std::uint32_t {
+        auto quotient = std::uint32_t(0) ;
+        while (get(1) != 0){
+            if (++quotient > 64){
+                throw std::runtime_error("Hue archive block is corrupt.");
+            }
+        }
+        return (quotient<<k) | get(k) ;
+    }
+};
+
+//=======================================================================================================================
+// The ramp steps of each channel are -31 to 31, zigzag folds them to 0 to 62
+constexpr auto zigzag(int delta) ->std::uint32_t {
+    return delta < 0 ? static_cast<std::uint32_t>((-2*delta)-1) : static_cast<std::uint32_t>(2*delta) ;
+}
+constexpr auto unzigzag(std::uint32_t value) ->int {
+    return (value&1) ? -static_cast<int>((value+1)/2) : static_cast<int>(value/2) ;
+}
+constexpr auto channelShift = std::array<int,3>{10,5,0} ;
+constexpr auto maxRice = 6 ;
+
+//=======================================================================================================================
+// Number of bytes of a mul holding count entries
+constexpr auto entryBytes(std::uint64_t count) ->std::uint64_t {
+    return count == 0 ? 0 : entryOffset(count-1) + hueentry_size ;
+}
+
+//=======================================================================================================================
+// huearchive_t
+//=======================================================================================================================
+
+//=======================================================================================================================
+huearchive_t::huearchive_t():count(0),blocksize(defaultBlocksize){
+    index.push_back(0);
+}
+//=======================================================================================================================
+huearchive_t::huearchive_t(const std::filesystem::path &path):huearchive_t(){
+    load(path);
+}
+//=======================================================================================================================
+huearchive_t::huearchive_t(const std::vector<std::uint8_t> &mul,std::uint32_t entriesPerBlock):huearchive_t(){
+    if ((entriesPerBlock == 0) || (entriesPerBlock > 0xFFFF)){
+        throw std::runtime_error("Invalid archive block size: "s + std::to_string(entriesPerBlock));
+    }
+    blocksize = entriesPerBlock ;
+    count = static_cast<std::uint32_t>(entryCount(mul.size())) ;
+    auto used = entryBytes(count) ;
+    tail.assign(mul.begin()+static_cast<std::ptrdiff_t>(used),mul.end());
+    auto groups = stock_format::roundUp(count)/stock_format::entriesPerGroup ;
+    for (std::uint32_t group = 0 ; group<groups;group++){
+        auto value = huecodec::load<std::uint32_t>(mul.data()+(std::uint64_t(group)*huegroup_size)) ;
+        if (value != 0){
+            headers.push_back(std::make_pair(group,value));
+        }
+    }
+    blankmap.assign((static_cast<size_t>(count)+7)/8,0);
+    auto distinct = std::map<std::array<std::uint8_t,20>,std::uint32_t>() ;
+    auto nameindex = std::vector<std::uint32_t>(count,0) ;
+    for (std::uint32_t id = 0 ; id<count;id++){
+        auto record = mul.data()+entryOffset(id) ;
+        if (std::all_of(record,record+hueentry_size,[](std::uint8_t value){return value == 0;})){
+            blankmap[id/8] |= static_cast<std::uint8_t>(1<<(id%8)) ;
+            continue;
+        }
+        auto name = std::array<std::uint8_t,20>() ;
+        std::copy(record+stock_format::nameOffset,record+stock_format::nameOffset+stock_format::nameLength,name.begin());
+        auto [iter,inserted] = distinct.insert(std::make_pair(name,static_cast<std::uint32_t>(names.size())));
+        if (inserted){
+            names.push_back(name);
+        }
+        nameindex[id] = iter->second ;
+    }
+    auto blockcount = (count + blocksize - 1)/blocksize ;
+    auto encoded = std::vector<std::vector<std::uint8_t>>(blockcount) ;
+    parallel::forEach(blockcount, [this,&mul,&nameindex,&encoded](size_t first,size_t last,size_t){
+        for (auto block = first ; block<last;block++){
+            encoded[block] = encodeBlock(mul,static_cast<std::uint32_t>(block),nameindex);
+        }
+    });
+    for (const auto &block:encoded){
+        blocks.insert(blocks.end(),block.begin(),block.end());
+        index.push_back(static_cast<std::uint32_t>(blocks.size()));
+    }
+}
+//=======================================================================================================================
+auto huearchive_t::nameBits() const ->int {
+    auto bits = 0 ;
+    while ((std::uint64_t(1)<<bits) < names.size()){
+        bits++ ;
+    }
+    return bits ;
+}
+//=======================================================================================================================
+auto huearchive_t::encodeBlock(const std::vector<std::uint8_t> &mul,std::uint32_t block,const std::vector<std::uint32_t> &nameindex) const ->std::vector<std::uint8_t> {
+    auto first = block*blocksize ;
+    auto last = std::min(count,first+blocksize) ;
+    auto ramps = std::vector<std::array<std::uint16_t,stock_format::colorCount>>() ;
+    auto ids = std::vector<std::uint32_t>() ;
+    for (auto id = first ; id<last;id++){
+        if (!blank(id)){
+            ramps.emplace_back();
+            huecodec::loadArray(mul.data()+entryOffset(id)+stock_format::colorsOffset,ramps.back().data(),stock_format::colorCount);
+            ids.push_back(id);
+        }
+    }
+    // Pick the Rice parameter of each channel that codes this block's steps in the fewest bits
+    auto k = std::array<int,3>{} ;
+    for (auto channel = 0 ; channel<3;channel++){
+        auto cost = std::array<std::uint64_t,maxRice+1>{} ;
+        for (const auto &ramp:ramps){
+            for (size_t j = 1 ; j<ramp.size();j++){
+                auto value = zigzag(static_cast<int>((ramp[j]>>channelShift[channel])&0x1f) - static_cast<int>((ramp[j-1]>>channelShift[channel])&0x1f)) ;
+                for (auto bits = 0 ; bits<=maxRice;bits++){
+                    cost[bits] += (value>>bits) + 1 + bits ;
+                }
+            }
+        }
+        k[channel] = static_cast<int>(std::min_element(cost.begin(),cost.end()) - cost.begin()) ;
+    }
+    auto rvalue = std::vector<std::uint8_t>() ;
+    auto writer = bitwriter_t(rvalue) ;
+    for (auto channel = 0 ; channel<3;channel++){
+        writer.put(static_cast<std::uint32_t>(k[channel]),3);
+    }
+    auto namebits = nameBits() ;
+    for (size_t entry = 0 ; entry<ids.size();entry++){
+        const auto &ramp = ramps[entry] ;
+        auto record = mul.data()+entryOffset(ids[entry]) ;
+        writer.put(nameindex[ids[entry]],namebits);
+        writer.put(ramp[0],16);
+        auto high = std::uint32_t(0) ;
+        for (size_t j = 1 ; j<ramp.size();j++){
+            for (auto channel = 0 ; channel<3;channel++){
+                writer.rice(zigzag(static_cast<int>((ramp[j]>>channelShift[channel])&0x1f) - static_cast<int>((ramp[j-1]>>channelShift[channel])&0x1f)),k[channel]);
+            }
+            high |= static_cast<std::uint32_t>(ramp[j]>>15) << (j-1) ;
+        }
+        writer.put(high != 0,1);
+        if (high != 0){
+            writer.put(high,31);
+        }
+        auto start = huecodec::load<std::uint16_t>(record+stock_format::tableStartOffset) ;
+        auto end = huecodec::load<std::uint16_t>(record+stock_format::tableEndOffset) ;
+        writer.put(start != ramp.front(),1);
+        if (start != ramp.front()){
+            writer.put(start,16);
+        }
+        writer.put(end != ramp.back(),1);
+        if (end != ramp.back()){
+            writer.put(end,16);
+        }
+    }
+    writer.finish();
+    return rvalue ;
+}
+//=======================================================================================================================
+// Decodes the entries of the block below last into records (hueentry_size bytes per id from the
+// start of the block, blank entries are left untouched)
+auto huearchive_t::decodeBlock(std::uint32_t block,std::uint32_t last,std::uint8_t *records) const ->void {
+    auto first = block*blocksize ;
+    last = std::min(last,std::min(count,first+blocksize)) ;
+    auto reader = bitreader_t(blocks.data()+index[block],index[block+1]-index[block]) ;
+    auto k = std::array<int,3>{} ;
+    for (auto channel = 0 ; channel<3;channel++){
+        k[channel] = static_cast<int>(reader.get(3)) ;
+    }
+    auto namebits = nameBits() ;
+    auto ramp = std::array<std::uint16_t,stock_format::colorCount>() ;
+    for (auto id = first ; id<last;id++){
+        if (blank(id)){
+            continue;
+        }
+        auto record = records + (std::uint64_t(id-first)*hueentry_size) ;
+        auto name = reader.get(namebits) ;
+        if (name >= names.size()){
+            throw std::runtime_error("Hue archive block is corrupt.");
+        }
+        ramp[0] = static_cast<std::uint16_t>(reader.get(16)) ;
+        auto channels = std::array<int,3>{(ramp[0]>>10)&0x1f,(ramp[0]>>5)&0x1f,ramp[0]&0x1f} ;
+        for (size_t j = 1 ; j<ramp.size();j++){
+            for (auto channel = 0 ; channel<3;channel++){
+                channels[channel] = (channels[channel] + unzigzag(reader.rice(k[channel]))) & 0x1f ;
+            }
+            ramp[j] = static_cast<std::uint16_t>((channels[0]<<10) | (channels[1]<<5) | channels[2]) ;
+        }
+        if (reader.get(1) != 0){
+            auto high = reader.get(31) ;
+            for (size_t j = 1 ; j<ramp.size();j++){
+                ramp[j] |= static_cast<std::uint16_t>(((high>>(j-1))&1)<<15) ;
+            }
+        }
+        auto start = reader.get(1) != 0 ? static_cast<std::uint16_t>(reader.get(16)) : ramp.front() ;
+        auto end = reader.get(1) != 0 ? static_cast<std::uint16_t>(reader.get(16)) : ramp.back() ;
+        huecodec::storeArray(record+stock_format::colorsOffset,ramp.data(),ramp.size());
+        huecodec::store(record+stock_format::tableStartOffset,start);
+        huecodec::store(record+stock_format::tableEndOffset,end);
+        std::copy(names[name].begin(),names[name].end(),record+stock_format::nameOffset);
+    }
+}
+//=======================================================================================================================
+auto huearchive_t::load(const std::filesystem::path &path) ->void {
+    if (!std::filesystem::exists(path)){
+        throw std::runtime_error("Does not exist: "s + path.string());
+    }
+    auto input = std::ifstream(path.string(),std::ios::binary) ;
+    if (!input.is_open()){
+        throw std::runtime_error("Unable to open: "s + path.string());
+    }
+    auto data = std::vector<std::uint8_t>(std::istreambuf_iterator<char>(input),std::istreambuf_iterator<char>()) ;
+    auto offset = size_t(0) ;
+    auto take = [&data,&offset,&path](size_t length) ->const std::uint8_t* {
+        if (data.size() - offset < length){
+            throw std::runtime_error("Truncated hue archive: "s + path.string());
+        }
+        offset += length ;
+        return data.data() + offset - length ;
+    };
+    auto magic = take(4) ;
+    if (!std::equal(magic,magic+4,"HUEZ") || (huecodec::load<std::uint16_t>(take(2)) != 1)){
+        throw std::runtime_error("Not a hue archive: "s + path.string());
+    }
+    blocksize = huecodec::load<std::uint16_t>(take(2)) ;
+    count = huecodec::load<std::uint32_t>(take(4)) ;
+    auto namecount = huecodec::load<std::uint32_t>(take(4)) ;
+    auto blockcount = huecodec::load<std::uint32_t>(take(4)) ;
+    auto headercount = huecodec::load<std::uint32_t>(take(4)) ;
+    auto taillength = huecodec::load<std::uint32_t>(take(4)) ;
+    if ((blocksize == 0) || (blockcount != (std::uint64_t(count) + blocksize - 1)/blocksize)){
+        throw std::runtime_error("Not a hue archive: "s + path.string());
+    }
+    names.resize(namecount);
+    for (auto &name:names){
+        auto bytes = take(name.size()) ;
+        std::copy(bytes,bytes+name.size(),name.begin());
+    }
+    auto bitmap = take((static_cast<size_t>(count)+7)/8) ;
+    blankmap.assign(bitmap,bitmap+((static_cast<size_t>(count)+7)/8));
+    headers.resize(headercount);
+    for (auto &header:headers){
+        header.first = huecodec::load<std::uint32_t>(take(4)) ;
+        header.second = huecodec::load<std::uint32_t>(take(4)) ;
+        if (header.first >= stock_format::roundUp(count)/stock_format::entriesPerGroup){
+            throw std::runtime_error("Not a hue archive: "s + path.string());
+        }
+    }
+    auto bytes = take(taillength) ;
+    tail.assign(bytes,bytes+taillength);
+    index.resize(static_cast<size_t>(blockcount)+1);
+    for (auto &offset:index){
+        offset = huecodec::load<std::uint32_t>(take(4)) ;
+    }
+    bytes = take(index.back()) ;
+    blocks.assign(bytes,bytes+index.back());
+    if (!std::is_sorted(index.begin(),index.end()) || (index.front() != 0)){
+        throw std::runtime_error("Not a hue archive: "s + path.string());
+    }
+}
+//=======================================================================================================================
+auto huearchive_t::save(const std::filesystem::path &path) const ->void {
+    auto data = std::vector<std::uint8_t>() ;
+    auto put = [&data](auto value){
+        auto offset = data.size() ;
+        data.resize(offset + sizeof(value));
+        huecodec::store(data.data()+offset,value);
+    };
+    data.insert(data.end(),{'H','U','E','Z'});
+    put(std::uint16_t(1));
+    put(static_cast<std::uint16_t>(blocksize));
+    put(count);
+    put(static_cast<std::uint32_t>(names.size()));
+    put(static_cast<std::uint32_t>(index.size()-1));
+    put(static_cast<std::uint32_t>(headers.size()));
+    put(static_cast<std::uint32_t>(tail.size()));
+    for (const auto &name:names){
+        data.insert(data.end(),name.begin(),name.end());
+    }
+    data.insert(data.end(),blankmap.begin(),blankmap.end());
+    for (const auto &[group,value]:headers){
+        put(group);
+        put(value);
+    }
+    data.insert(data.end(),tail.begin(),tail.end());
+    for (const auto &offset:index){
+        put(offset);
+    }
+    data.insert(data.end(),blocks.begin(),blocks.end());
+
+    auto output = std::ofstream(path.string(),std::ios::binary) ;
+    if (!output.is_open()){
+        throw std::runtime_error("Unable to create: "s + path.string());
+    }
+    output.write(reinterpret_cast<const char*>(data.data()),static_cast<std::streamsize>(data.size()));
+    if (!output.good()){
+        throw std::runtime_error("Unable to write: "s + path.string());
+    }
+}
+//=======================================================================================================================
+auto huearchive_t::size() const ->size_t {
+    return count ;
+}
+//=======================================================================================================================
+auto huearchive_t::blank(std::uint32_t id) const ->bool {
+    return (blankmap[id/8] & (1<<(id%8))) != 0 ;
+}
+//=======================================================================================================================
+// Only the block holding the id is decoded, and only up to the id
+auto huearchive_t::operator[](std::uint32_t id) const ->hueentry_t {
+    if (id >= count){
+        throw std::out_of_range("Hue id exceeds the number of hues: "s + std::to_string(id));
+    }
+    auto block = id/blocksize ;
+    auto records = std::vector<std::uint8_t>(std::uint64_t(id - (block*blocksize) + 1)*hueentry_size,0) ;
+    decodeBlock(block,id+1,records.data());
+    return hueentry_t(std::vector<std::uint8_t>(records.end()-hueentry_size,records.end())) ;
+}
+//=======================================================================================================================
+auto huearchive_t::decompress() const ->std::vector<std::uint8_t> {
+    auto used = entryBytes(count) ;
+    auto rvalue = std::vector<std::uint8_t>(used + tail.size(),0) ;
+    for (const auto &[group,value]:headers){
+        huecodec::store(rvalue.data()+(std::uint64_t(group)*huegroup_size),value);
+    }
+    parallel::forEach(index.size()-1, [this,&rvalue](size_t first,size_t last,size_t){
+        auto records = std::vector<std::uint8_t>(std::uint64_t(blocksize)*hueentry_size) ;
+        for (auto block = static_cast<std::uint32_t>(first) ; block<last;block++){
+            std::fill(records.begin(),records.end(),0);
+            decodeBlock(block,count,records.data());
+            auto start = block*blocksize ;
+            auto end = std::min(count,start+blocksize) ;
+            for (auto id = start ; id<end;id++){
+                auto record = records.begin() + static_cast<std::ptrdiff_t>(std::uint64_t(id-start)*hueentry_size) ;
+                std::copy(record,record+hueentry_size,rvalue.begin()+static_cast<std::ptrdiff_t>(entryOffset(id)));
+            }
+        }
+    });
+    std::copy(tail.begin(),tail.end(),rvalue.begin()+static_cast<std::ptrdiff_t>(used));
+    return rvalue ;
+}
+
+//=======================================================================================================================
+auto isArchive(const std::filesystem::path &path) ->bool {
+    return path.extension() == ".huez" ;
+}
+//=======================================================================================================================
+auto packMul(const std::filesystem::path &huepath,const std::filesystem::path &archivepath) ->void {
+    if (!std::filesystem::exists(huepath)){
+        throw std::runtime_error("Does not exist: "s + huepath.string());
+    }
+    auto input = std::ifstream(huepath.string(),std::ios::binary) ;
+    if (!input.is_open()){
+        throw std::runtime_error("Unable to open: "s + huepath.string());
+    }
+    auto mul = std::vector<std::uint8_t>(std::istreambuf_iterator<char>(input),std::istreambuf_iterator<char>()) ;
+    huearchive_t(mul).save(archivepath);
+    huejournal_t::discard(archivepath);
+}
+//=======================================================================================================================
+auto unpackMul(const std::filesystem::path &archivepath,const std::filesystem::path &huepath) ->void {
+    auto mul = huearchive_t(archivepath).decompress() ;
+    auto output = std::ofstream(huepath.string(),std::ios::binary) ;
+    if (!output.is_open()){
+        throw std::runtime_error("Unable to create: "s + huepath.string());
+    }
+    output.write(reinterpret_cast<const char*>(mul.data()),static_cast<std::streamsize>(mul.size()));
+    if (!output.good()){
+        throw std::runtime_error("Unable to write: "s + huepath.string());
+    }
+    output.close();
+    huejournal_t::discard(huepath);
+}
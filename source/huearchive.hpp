@@ -0,0 +1,68 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#ifndef huearchive_hpp
+#define huearchive_hpp
+
+#include <cstdint>
+#include <array>
+#include <utility>
+#include <vector>
+#include <filesystem>
+
+#include "huedata.hpp"
+
+//=======================================================================================================================
+// huearchive_t  A compressed hue mul (.huez), that restores the original file byte for byte.
+//     char     magic[4]          "HUEZ"
+//     WORD     version           1
+//     WORD     blocksize         entries per block
+//     DWORD    count, namecount, blockcount, headercount, taillength
+//     CHAR     names[namecount][20]                 every distinct raw name field
+//     BYTE     blank[(count+7)/8]                   bit set for an all zero entry
+//     DWORD    headers[headercount][2]              group number and value of any non zero group header
+//     BYTE     tail[taillength]                     bytes past the last whole entry
+//     DWORD    index[blockcount+1]                  offset of each block into the block data
+//     BYTE     blocks[]
+// Each block is a bit stream over its non blank entries. It starts with a Rice parameter for each
+// channel, and then each entry is: its name index, the first color, the red, green and blue steps
+// along the ramp (zigzag and Rice coded), any high color bits, and TableStart/TableEnd when they
+// are not the first and last colors. Blocks decode independently, so one entry can be read by
+// decoding only its block, and a whole table is decoded in parallel.
+//=======================================================================================================================
+class huearchive_t {
+    std::uint32_t count ;
+    std::uint32_t blocksize ;
+    std::vector<std::array<std::uint8_t,20>> names ;
+    std::vector<std::uint8_t> blankmap ;
+    std::vector<std::pair<std::uint32_t,std::uint32_t>> headers ;
+    std::vector<std::uint8_t> tail ;
+    std::vector<std::uint32_t> index ;
+    std::vector<std::uint8_t> blocks ;
+
+    auto nameBits() const ->int ;
+    auto encodeBlock(const std::vector<std::uint8_t> &mul,std::uint32_t block,const std::vector<std::uint32_t> &nameindex) const ->std::vector<std::uint8_t> ;
+    auto decodeBlock(std::uint32_t block,std::uint32_t last,std::uint8_t *mul) const ->void ;
+public:
+    static constexpr auto defaultBlocksize = std::uint32_t(256) ;
+    huearchive_t() ;
+    huearchive_t(const std::filesystem::path &path) ;
+    // Compresses the bytes of a hue mul
+    huearchive_t(const std::vector<std::uint8_t> &mul,std::uint32_t entriesPerBlock=defaultBlocksize) ;
+
+    auto load(const std::filesystem::path &path) ->void ;
+    auto save(const std::filesystem::path &path) const ->void ;
+
+    auto size() const ->size_t ;
+    auto blank(std::uint32_t id) const ->bool ;
+    auto operator[](std::uint32_t id) const ->hueentry_t ;
+    // The bytes of the original hue mul
+    auto decompress() const ->std::vector<std::uint8_t> ;
+};
+
+// True if the path names a .huez archive
+auto isArchive(const std::filesystem::path &path) ->bool ;
+// Converts between a hue mul and an archive, byte for byte
+auto packMul(const std::filesystem::path &huepath,const std::filesystem::path &archivepath) ->void ;
+auto unpackMul(const std::filesystem::path &archivepath,const std::filesystem::path &huepath) ->void ;
+
+#endif /* huearchive_hpp */
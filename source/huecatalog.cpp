@@ -0,0 +1,265 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#include "huecatalog.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include "huecodec.hpp"
+#include "huejournal.hpp"
+#include "hueloader.hpp"
+
+using namespace std::string_literals;
+
+//=======================================================================================================================
+// huecatalog_t
+//=======================================================================================================================
+
+//=======================================================================================================================
+huecatalog_t::huecatalog_t(const std::filesystem::path &catalogpath){
+    load(catalogpath);
+}
+//=======================================================================================================================
+// Files are identified by their absolute, normalized path
+auto huecatalog_t::key(const std::filesystem::path &path) ->std::string {
+    return std::filesystem::absolute(path).lexically_normal().string() ;
+}
+//=======================================================================================================================
+auto huecatalog_t::load(const std::filesystem::path &catalogpath) ->void {
+    auto input = std::ifstream(catalogpath.string(),std::ios::binary) ;
+    if (!input.is_open()){
+        throw std::runtime_error("Unable to open: "s + catalogpath.string());
+    }
+    auto data = std::vector<std::uint8_t>(std::istreambuf_iterator<char>(input),std::istreambuf_iterator<char>()) ;
+    auto offset = size_t(0) ;
+    auto take = [&data,&offset,&catalogpath](size_t length) ->const std::uint8_t* {
+        if (data.size() - offset < length){
+            throw std::runtime_error("Truncated hue catalog: "s + catalogpath.string());
+        }
+        offset += length ;
+        return data.data() + offset - length ;
+    };
+    auto text = [&take](size_t length) ->std::string {
+        auto bytes = take(length) ;
+        return std::string(bytes,bytes+length) ;
+    };
+    auto version = (text(4) == "HUEC") ? huecodec::load<std::uint16_t>(take(2)) : std::uint16_t(0) ;
+    if ((version != 1) && (version != 2)){
+        throw std::runtime_error("Not a hue catalog: "s + catalogpath.string());
+    }
+    take(2);
+    files.resize(huecodec::load<std::uint32_t>(take(4)));
+    occurrences.resize(huecodec::load<std::uint32_t>(take(4)));
+    for (auto &entry:files){
+        entry.path = text(huecodec::load<std::uint16_t>(take(2))) ;
+        entry.size = huecodec::load<std::uint64_t>(take(8)) ;
+        entry.stamp = static_cast<std::int64_t>(huecodec::load<std::uint64_t>(take(8))) ;
+        if (version == 1){
+            // Journals were not recorded, so the file is read again on its next ingest
+            entry.journalsize = ~std::uint64_t(0) ;
+            entry.journalstamp = 0 ;
+        }
+        else {
+            entry.journalsize = huecodec::load<std::uint64_t>(take(8)) ;
+            entry.journalstamp = static_cast<std::int64_t>(huecodec::load<std::uint64_t>(take(8))) ;
+        }
+    }
+    for (auto &entry:occurrences){
+        entry.hash = huecodec::load<std::uint64_t>(take(8)) ;
+        entry.file = huecodec::load<std::uint32_t>(take(4)) ;
+        entry.id = huecodec::load<std::uint32_t>(take(4)) ;
+        entry.name = text(*take(1)) ;
+        if (entry.file >= files.size()){
+            throw std::runtime_error("Not a hue catalog: "s + catalogpath.string());
+        }
+    }
+    reindex();
+}
+//=======================================================================================================================
+// Written to a temporary and renamed, so an interrupted save leaves the old catalog intact
+auto huecatalog_t::save(const std::filesystem::path &catalogpath) const ->void {
+    auto data = std::vector<std::uint8_t>() ;
+    auto put = [&data](auto value){
+        auto offset = data.size() ;
+        data.resize(offset + sizeof(value));
+        huecodec::store(data.data()+offset,value);
+    };
+    data.insert(data.end(),{'H','U','E','C'});
+    put(std::uint16_t(2));
+    put(std::uint16_t(0));
+    put(static_cast<std::uint32_t>(files.size()));
+    put(static_cast<std::uint32_t>(occurrences.size()));
+    for (const auto &entry:files){
+        put(static_cast<std::uint16_t>(entry.path.size()));
+        data.insert(data.end(),entry.path.begin(),entry.path.end());
+        put(entry.size);
+        put(static_cast<std::uint64_t>(entry.stamp));
+        put(entry.journalsize);
+        put(static_cast<std::uint64_t>(entry.journalstamp));
+    }
+    for (const auto &entry:occurrences){
+        put(entry.hash);
+        put(entry.file);
+        put(entry.id);
+        put(static_cast<std::uint8_t>(entry.name.size()));
+        data.insert(data.end(),entry.name.begin(),entry.name.end());
+    }
+    auto temppath = catalogpath ;
+    temppath += ".tmp" ;
+    {
+        auto output = std::ofstream(temppath.string(),std::ios::binary) ;
+        if (!output.is_open()){
+            throw std::runtime_error("Unable to create: "s + temppath.string());
+        }
+        output.write(reinterpret_cast<const char*>(data.data()),static_cast<std::streamsize>(data.size()));
+        if (!output.good()){
+            throw std::runtime_error("Unable to write: "s + temppath.string());
+        }
+    }
+    std::filesystem::rename(temppath, catalogpath);
+}
+//=======================================================================================================================
+auto huecatalog_t::ingest(const std::filesystem::path &huepath,std::uint32_t maxnum) ->size_t {
+    return ingest(std::vector<std::filesystem::path>{huepath},maxnum).front() ;
+}
+//=======================================================================================================================
+auto huecatalog_t::ingest(const std::vector<std::filesystem::path> &huepaths,std::uint32_t maxnum) ->std::vector<size_t> {
+    auto indices = std::vector<size_t>() ;
+    auto changed = std::vector<std::filesystem::path>() ;
+    for (const auto &huepath:huepaths){
+        indices.push_back(prepare(huepath));
+        if (indices.back() != std::string::npos){
+            changed.push_back(huepath);
+        }
+    }
+    auto rvalue = std::vector<size_t>(huepaths.size(),0) ;
+    auto loader = hueloader_t(changed,maxnum) ;
+    auto next = size_t(0) ;
+    for (size_t j = 0 ; j<indices.size();j++){
+        if (indices[j] != std::string::npos){
+            rvalue[j] = record(indices[j],loader[next++].get()) ;
+        }
+    }
+    reindex();
+    return rvalue ;
+}
+//=======================================================================================================================
+// Returns the index of the file to read, after dropping any occurrences it had, or npos if it is unchanged
+auto huecatalog_t::prepare(const std::filesystem::path &huepath) ->size_t {
+    if (!std::filesystem::exists(huepath)){
+        throw std::runtime_error("Does not exist: "s + huepath.string());
+    }
+    auto size = static_cast<std::uint64_t>(std::filesystem::file_size(huepath)) ;
+    auto stamp = static_cast<std::int64_t>(std::filesystem::last_write_time(huepath).time_since_epoch().count()) ;
+    // Journaled edits change neither the size nor the write time of the mul
+    auto journalpath = huejournal_t::path(huepath) ;
+    auto journalsize = std::uint64_t(0) ;
+    auto journalstamp = std::int64_t(0) ;
+    if (std::filesystem::exists(journalpath)){
+        journalsize = static_cast<std::uint64_t>(std::filesystem::file_size(journalpath)) ;
+        journalstamp = static_cast<std::int64_t>(std::filesystem::last_write_time(journalpath).time_since_epoch().count()) ;
+    }
+    auto index = find(huepath) ;
+    if (index == std::string::npos){
+        index = files.size() ;
+        files.push_back(file_t{key(huepath),size,stamp,journalsize,journalstamp});
+    }
+    else if ((files[index].size == size) && (files[index].stamp == stamp) && (files[index].journalsize == journalsize) && (files[index].journalstamp == journalstamp)){
+        return std::string::npos ;
+    }
+    else {
+        auto file = static_cast<std::uint32_t>(index) ;
+        occurrences.erase(std::remove_if(occurrences.begin(),occurrences.end(),[file](const occurrence_t &entry){
+            return entry.file == file ;
+        }),occurrences.end());
+        files[index].size = size ;
+        files[index].stamp = stamp ;
+        files[index].journalsize = journalsize ;
+        files[index].journalstamp = journalstamp ;
+    }
+    return index ;
+}
+//=======================================================================================================================
+// Adds the occurrences of a file (the caller reindexes)
+auto huecatalog_t::record(size_t index,const huestorage_t &hues) ->size_t {
+    auto added = std::vector<occurrence_t>() ;
+    for (std::uint32_t id = 0 ; id<hues.size();id++){
+        const auto &entry = hues[id] ;
+        if (!entry.empty()){
+            added.push_back(occurrence_t{entry.hash(false),static_cast<std::uint32_t>(index),id,entry.name()});
+        }
+    }
+    auto order = [](const occurrence_t &lhs,const occurrence_t &rhs){
+        return std::tie(lhs.hash,lhs.file,lhs.id) < std::tie(rhs.hash,rhs.file,rhs.id) ;
+    };
+    std::sort(added.begin(),added.end(),order);
+    auto middle = occurrences.insert(occurrences.end(),added.begin(),added.end()) ;
+    std::inplace_merge(occurrences.begin(),middle,occurrences.end(),order);
+    return added.size() ;
+}
+//=======================================================================================================================
+auto huecatalog_t::reindex() ->void {
+    positions.resize(occurrences.size());
+    for (std::uint32_t j = 0 ; j<positions.size();j++){
+        positions[j] = j ;
+    }
+    std::sort(positions.begin(),positions.end(),[this](std::uint32_t lhs,std::uint32_t rhs){
+        return std::tie(occurrences[lhs].file,occurrences[lhs].id) < std::tie(occurrences[rhs].file,occurrences[rhs].id) ;
+    });
+}
+//=======================================================================================================================
+auto huecatalog_t::file(std::uint32_t index) const ->const file_t& {
+    if (index >= files.size()){
+        throw std::out_of_range("Catalog file index out of range: "s + std::to_string(index));
+    }
+    return files[index] ;
+}
+//=======================================================================================================================
+auto huecatalog_t::find(const std::filesystem::path &huepath) const ->size_t {
+    auto name = key(huepath) ;
+    auto iter = std::find_if(files.begin(),files.end(),[&name](const file_t &entry){
+        return entry.path == name ;
+    });
+    return iter == files.end() ? std::string::npos : static_cast<size_t>(iter - files.begin()) ;
+}
+//=======================================================================================================================
+auto huecatalog_t::lookup(std::uint64_t hash) const ->std::vector<occurrence_t> {
+    auto first = std::lower_bound(occurrences.begin(),occurrences.end(),hash,[](const occurrence_t &entry,std::uint64_t value){
+        return entry.hash < value ;
+    });
+    auto last = std::upper_bound(first,occurrences.end(),hash,[](std::uint64_t value,const occurrence_t &entry){
+        return value < entry.hash ;
+    });
+    return std::vector<occurrence_t>(first,last) ;
+}
+//=======================================================================================================================
+auto huecatalog_t::hash(std::uint32_t file,std::uint32_t id) const ->std::uint64_t {
+    auto iter = std::lower_bound(positions.begin(),positions.end(),std::make_pair(file,id),[this](std::uint32_t position,const std::pair<std::uint32_t,std::uint32_t> &value){
+        return std::make_pair(occurrences[position].file,occurrences[position].id) < value ;
+    });
+    if ((iter == positions.end()) || (occurrences[*iter].file != file) || (occurrences[*iter].id != id)){
+        return 0 ;
+    }
+    return occurrences[*iter].hash ;
+}
+//=======================================================================================================================
+auto huecatalog_t::where(std::uint32_t file,std::uint32_t id) const ->std::vector<occurrence_t> {
+    auto rvalue = std::vector<occurrence_t>() ;
+    auto value = hash(file,id) ;
+    if (value != 0){
+        for (auto &entry:lookup(value)){
+            if ((entry.file != file) || (entry.id != id)){
+                rvalue.push_back(std::move(entry));
+            }
+        }
+    }
+    return rvalue ;
+}
+//=======================================================================================================================
+auto huecatalog_t::size() const ->size_t {
+    return occurrences.size() ;
+}
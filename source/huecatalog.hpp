@@ -0,0 +1,74 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#ifndef huecatalog_hpp
+#define huecatalog_hpp
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#include "huedata.hpp"
+
+//=======================================================================================================================
+// huecatalog_t  A persistent index of where each hue ramp occurs across many hue muls.
+// Occurrences are keyed by hueentry_t::hash(false), the hash of the masked colors, so the same ramp
+// is found under any id or name (and entries that compare equal always share a key). Blank entries
+// are not catalogued. positions orders the occurrences by file and id, for finding the hash of an
+// entry. Queries are answered from the catalog alone, the muls are only read when
+// ingested. Ingesting a mul that is already catalogued replaces its occurrences, unless its size
+// and write time, and those of its journal (0 if it has none), are unchanged. On disk (little endian):
+//     char     magic[4]    "HUEC"
+//     WORD     version     2
+//     WORD     reserved
+//     DWORD    filecount, occurrencecount
+//     files:        WORD length, CHAR path[length], QWORD size, QWORD write time,
+//                   QWORD journal size, QWORD journal write time
+//     occurrences:  QWORD hash, DWORD file, DWORD id, BYTE length, CHAR name[length]   (in hash order)
+//=======================================================================================================================
+class huecatalog_t {
+public:
+    struct file_t {
+        std::string path ;
+        std::uint64_t size ;
+        std::int64_t stamp ;
+        std::uint64_t journalsize ;
+        std::int64_t journalstamp ;
+    };
+    struct occurrence_t {
+        std::uint64_t hash ;
+        std::uint32_t file ;
+        std::uint32_t id ;
+        std::string name ;
+    };
+private:
+    std::vector<file_t> files ;
+    std::vector<occurrence_t> occurrences ;
+    std::vector<std::uint32_t> positions ;
+    
+    static auto key(const std::filesystem::path &path) ->std::string ;
+    auto reindex() ->void ;
+    auto prepare(const std::filesystem::path &huepath) ->size_t ;
+    auto record(size_t index,const huestorage_t &hues) ->size_t ;
+public:
+    huecatalog_t() = default ;
+    huecatalog_t(const std::filesystem::path &catalogpath) ;
+    auto load(const std::filesystem::path &catalogpath) ->void ;
+    auto save(const std::filesystem::path &catalogpath) const ->void ;
+    
+    // Returns the number of occurrences added (0 if the file was unchanged)
+    auto ingest(const std::filesystem::path &huepath,std::uint32_t maxnum=3000) ->size_t ;
+    // The same for many muls, the changed ones being read concurrently (see hueloader_t)
+    auto ingest(const std::vector<std::filesystem::path> &huepaths,std::uint32_t maxnum=3000) ->std::vector<size_t> ;
+    auto file(std::uint32_t index) const ->const file_t& ;
+    // The index of a catalogued mul, or npos
+    auto find(const std::filesystem::path &huepath) const ->size_t ;
+    auto lookup(std::uint64_t hash) const ->std::vector<occurrence_t> ;
+    // The hash of a catalogued entry (0 if it is blank or not catalogued)
+    auto hash(std::uint32_t file,std::uint32_t id) const ->std::uint64_t ;
+    // Every other occurrence of the ramp at the id of a catalogued file
+    auto where(std::uint32_t file,std::uint32_t id) const ->std::vector<occurrence_t> ;
+    auto size() const ->size_t ;
+};
+
+#endif /* huecatalog_hpp */
@@ -0,0 +1,112 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#ifndef huecodec_hpp
+#define huecodec_hpp
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <array>
+#include <type_traits>
+
+//=======================================================================================================================
+// Little endian encoding of the mul records, independent of the build host.
+// On a little endian host every load and store is a plain memcpy. On a big endian host the values
+// are copied in bulk and then swapped in a single tight loop, which the compiler vectorizes.
+//=======================================================================================================================
+namespace huecodec {
+    //=================================================================================
+#if defined(_WIN32) || (defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)) || defined(__LITTLE_ENDIAN__)
+    inline constexpr auto little = true ;
+#else
+    inline constexpr auto little = false ;
+#endif
+
+    //=================================================================================
+    template <typename T>
+    constexpr auto byteswap(T value) ->T {
+        static_assert(std::is_unsigned_v<T>, "byteswap requires an unsigned integer");
+        auto rvalue = T(0) ;
+        for (std::size_t j = 0 ; j<sizeof(T);j++){
+            rvalue = static_cast<T>((rvalue<<8) | ((value>>(j*8)) & 0xff)) ;
+        }
+        return rvalue ;
+    }
+    //=================================================================================
+    template <typename T>
+    constexpr auto toLittle(T value) ->T {
+        if constexpr (little) {
+            return value ;
+        }
+        else {
+            return byteswap(value) ;
+        }
+    }
+    //=================================================================================
+    template <typename T>
+    inline auto load(const std::uint8_t *data) ->T {
+        auto value = T(0) ;
+        std::memcpy(&value,data,sizeof(T));
+        return toLittle(value) ;
+    }
+    //=================================================================================
+    template <typename T>
+    inline auto store(std::uint8_t *data,T value) ->void {
+        value = toLittle(value) ;
+        std::memcpy(data,&value,sizeof(T));
+    }
+    //=================================================================================
+    template <typename T>
+    inline auto loadArray(const std::uint8_t *data,T *values,std::size_t count) ->void {
+        std::memcpy(values,data,count*sizeof(T));
+        if constexpr (!little) {
+            for (std::size_t j = 0 ; j<count;j++){
+                values[j] = byteswap(values[j]) ;
+            }
+        }
+    }
+    //=================================================================================
+    template <typename T>
+    inline auto storeArray(std::uint8_t *data,const T *values,std::size_t count) ->void {
+        if constexpr (little) {
+            std::memcpy(data,values,count*sizeof(T));
+        }
+        else {
+            for (std::size_t j = 0 ; j<count;j++){
+                store(data+(j*sizeof(T)),values[j]);
+            }
+        }
+    }
+
+    //=================================================================================
+    // Crc-32 (as used by png and zip) of encoded records. Start with 0xFFFFFFFF, and invert the result
+    constexpr auto makeCrcTable() ->std::array<std::uint32_t,256> {
+        auto rvalue = std::array<std::uint32_t,256>{} ;
+        for (std::uint32_t j = 0 ; j<256;j++){
+            auto value = j ;
+            for (auto bit = 0 ; bit<8;bit++){
+                value = (value&1) ? (0xEDB88320u ^ (value>>1)) : (value>>1) ;
+            }
+            rvalue[j] = value ;
+        }
+        return rvalue ;
+    }
+    inline constexpr auto crctable = makeCrcTable() ;
+    inline auto crc32(std::uint32_t crc,const std::uint8_t *data,std::size_t length) ->std::uint32_t {
+        for (std::size_t j = 0 ; j<length;j++){
+            crc = crctable[(crc ^ data[j]) & 0xff] ^ (crc>>8) ;
+        }
+        return crc ;
+    }
+
+    static_assert(byteswap(std::uint16_t(0x1234)) == 0x3412);
+    static_assert(byteswap(std::uint32_t(0x12345678)) == 0x78563412);
+    static_assert(byteswap(std::uint64_t(0x0123456789abcdef)) == 0xefcdab8967452301);
+    // Encoding then decoding gives the value back, whatever the host
+    static_assert(toLittle(toLittle(std::uint16_t(0xbeef))) == 0xbeef);
+    static_assert(toLittle(toLittle(std::uint32_t(0xdeadbeef))) == 0xdeadbeef);
+    static_assert(toLittle(toLittle(std::uint64_t(0x0123456789abcdef))) == 0x0123456789abcdef);
+    static_assert((crctable[1] == 0x77073096u) && (crctable[255] == 0x2d02ef8du));
+}
+
+#endif /* huecodec_hpp */
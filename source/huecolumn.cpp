@@ -0,0 +1,142 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#include "huecolumn.hpp"
+
+#include <stdexcept>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "colorspace.hpp"
+#include "huecodec.hpp"
+
+using namespace std::string_literals;
+
+//=======================================================================================================================
+// huecolumns_t
+//=======================================================================================================================
+
+//=======================================================================================================================
+// The colors are gathered once, and every other column is converted from that column a plane at a time
+huecolumns_t::huecolumns_t(const huestorage_t &storage):count(static_cast<std::uint32_t>(storage.size())){
+    auto total = static_cast<size_t>(count)*steps ;
+    blank.resize(count,0);
+    color.resize(total,0);
+    for (std::uint32_t id = 0 ; id<count;id++){
+        const auto &entry = storage[id] ;
+        blank[id] = entry.empty() ? 1 : 0 ;
+        for (auto j = 0 ; j<steps;j++){
+            color[(static_cast<size_t>(id)*steps)+j] = entry[j].color ;
+        }
+    }
+    red8.resize(total);
+    green8.resize(total);
+    blue8.resize(total);
+    linearRed.resize(total);
+    linearGreen.resize(total);
+    linearBlue.resize(total);
+    for (size_t j = 0 ; j<total;j++){
+        red8[j] = colorspace::rgb888[colorspace::red(color[j])] ;
+        green8[j] = colorspace::rgb888[colorspace::green(color[j])] ;
+        blue8[j] = colorspace::rgb888[colorspace::blue(color[j])] ;
+    }
+    for (size_t j = 0 ; j<total;j++){
+        linearRed[j] = colorspace::linear[colorspace::red(color[j])] ;
+        linearGreen[j] = colorspace::linear[colorspace::green(color[j])] ;
+        linearBlue[j] = colorspace::linear[colorspace::blue(color[j])] ;
+    }
+    labL.resize(total);
+    labA.resize(total);
+    labB.resize(total);
+    colorspace::lab(linearRed.data(), linearGreen.data(), linearBlue.data(), labL.data(), labA.data(), labB.data(), total);
+}
+//=======================================================================================================================
+// The file is modeled on numpy's .npy: a magic, a version, a little endian header length, and a
+// python literal header describing each column (name, dtype, shape, byte offset into the file).
+// Every column starts on a 64 byte boundary, so it can be mapped directly.
+auto huecolumns_t::save(std::ostream &output) const ->void {
+    constexpr auto alignment = size_t(64) ;
+    const auto order = huecodec::little ? "<"s : ">"s ;
+    struct column_t {
+        std::string name ;
+        std::string dtype ;
+        const void *data ;
+        size_t size ;
+        bool perstep ;
+    };
+    auto total = static_cast<size_t>(count)*steps ;
+    auto columns = std::vector<column_t>{
+        {"blank"s,"|u1"s,blank.data(),blank.size(),false},
+        {"color"s,order+"u2"s,color.data(),total*sizeof(std::uint16_t),true},
+        {"red8"s,"|u1"s,red8.data(),total,true},
+        {"green8"s,"|u1"s,green8.data(),total,true},
+        {"blue8"s,"|u1"s,blue8.data(),total,true},
+        {"linear_red"s,order+"f4"s,linearRed.data(),total*sizeof(float),true},
+        {"linear_green"s,order+"f4"s,linearGreen.data(),total*sizeof(float),true},
+        {"linear_blue"s,order+"f4"s,linearBlue.data(),total*sizeof(float),true},
+        {"lab_l"s,order+"f4"s,labL.data(),total*sizeof(float),true},
+        {"lab_a"s,order+"f4"s,labA.data(),total*sizeof(float),true},
+        {"lab_b"s,order+"f4"s,labB.data(),total*sizeof(float),true}
+    };
+    const auto magic = std::string("\x93HUECOL\x01\x00",9) ;
+    auto describe = [&](size_t start){
+        std::stringstream header ;
+        header <<"{'count': "<<count<<", 'steps': "<<steps<<", 'columns': [" ;
+        auto offset = start ;
+        for (const auto &column:columns){
+            header <<"('"<<column.name<<"', '"<<column.dtype<<"', ("<<count ;
+            header <<(column.perstep ? ", "s+std::to_string(steps)+")"s : ",)"s) ;
+            header <<", "<<offset<<"), " ;
+            offset += ((column.size + alignment -1)/alignment)*alignment ;
+        }
+        header <<"]}" ;
+        return header.str() ;
+    };
+    // The offsets are written into the header, so size the header, then describe with the final start
+    auto start = size_t(0) ;
+    auto header = std::string() ;
+    do {
+        header = describe(start) ;
+        auto used = magic.size() + 4 + header.size() + 1 ;
+        auto padded = ((used + alignment -1)/alignment)*alignment ;
+        if (padded == start){
+            header += std::string(padded - used,' ') + "\n"s ;
+            break;
+        }
+        start = padded ;
+    } while (true);
+    
+    auto length = static_cast<std::uint32_t>(header.size()) ;
+    std::uint8_t lengthbytes[4] ;
+    huecodec::store(lengthbytes,length);
+    output.write(magic.data(),magic.size());
+    output.write(reinterpret_cast<const char*>(lengthbytes),4);
+    output.write(header.data(),header.size());
+    auto padding = std::vector<char>(alignment,0) ;
+    for (const auto &column:columns){
+        output.write(reinterpret_cast<const char*>(column.data),column.size);
+        output.write(padding.data(), (alignment - (column.size%alignment))%alignment);
+    }
+}
+//=======================================================================================================================
+// A path of "-" writes the columns to stdout
+auto huecolumns_t::save(const std::filesystem::path &path) const ->void {
+    if (isStdio(path)){
+        binaryStdio(stdout);
+        save(std::cout);
+        std::cout.flush();
+        if (!std::cout.good()){
+            throw std::runtime_error("Unable to write columns to stdout");
+        }
+        return ;
+    }
+    auto output = std::ofstream(path.string(),std::ios::binary) ;
+    if (!output.is_open()){
+        throw std::runtime_error("Unable to create: "s + path.string());
+    }
+    save(output);
+    if (!output.good()){
+        throw std::runtime_error("Unable to write: "s + path.string());
+    }
+}
@@ -0,0 +1,37 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#ifndef huecolumn_hpp
+#define huecolumn_hpp
+
+#include <cstdint>
+#include <vector>
+#include <filesystem>
+#include <ostream>
+
+#include "huedata.hpp"
+
+//=======================================================================================================================
+// huecolumns_t  A columnar (structure of arrays) view of a hue table.
+// Each per color column holds count*32 values, entry major (the 32 steps of entry n start at n*32).
+//=======================================================================================================================
+struct huecolumns_t {
+    static constexpr auto steps = 32 ;
+    std::uint32_t count ;
+    std::vector<std::uint8_t> blank ;
+    std::vector<std::uint16_t> color ;
+    std::vector<std::uint8_t> red8 ;
+    std::vector<std::uint8_t> green8 ;
+    std::vector<std::uint8_t> blue8 ;
+    std::vector<float> linearRed ;
+    std::vector<float> linearGreen ;
+    std::vector<float> linearBlue ;
+    std::vector<float> labL ;
+    std::vector<float> labA ;
+    std::vector<float> labB ;
+    
+    huecolumns_t(const huestorage_t &storage) ;
+    auto save(const std::filesystem::path &path) const ->void ;
+    auto save(std::ostream &output) const ->void ;
+};
+
+#endif /* huecolumn_hpp */
@@ -2,14 +2,69 @@
 
 #include "huedata.hpp"
 #include "strutil.hpp"
+#include "huecodec.hpp"
+#include "huearchive.hpp"
+#include "huejournal.hpp"
 #include <iostream>
 #include <stdexcept>
 #include <algorithm>
 #include <fstream>
 #include <sstream>
+#include <functional>
+#include <bitset>
+#include <type_traits>
+#include <utility>
+#include <cstdio>
+#if defined(_WIN32)
+#include <io.h>
+#include <fcntl.h>
+#endif
 
 using namespace std::string_literals;
-constexpr auto hueentry_size = (32*2) + 2 + 2 +20 ;
+//=================================================================================
+// Number of bits set below bit of the block
+inline auto bitsBelow(std::uint64_t block,std::uint32_t bit) ->size_t {
+    return std::bitset<64>(block & ((std::uint64_t(1)<<bit)-1)).count() ;
+}
+
+
+//=================================================================================
+// A path of "-" is stdin when reading, and stdout when writing
+auto isStdio(const std::filesystem::path &huepath) ->bool {
+    return huepath.string() == "-" ;
+}
+//=================================================================================
+// Mul data through stdin/stdout must not have line endings translated
+auto binaryStdio(std::FILE *file) ->void {
+#if defined(_WIN32)
+    _setmode(_fileno(file), _O_BINARY);
+#else
+    (void)file ;
+#endif
+}
+//=================================================================================
+// A list of ids and inclusive id ranges, such as 1,5,10-20
+auto determine_ids(const std::string& list) ->std::vector<std::uint32_t> {
+    auto rvalue = std::vector<std::uint32_t>() ;
+    for (auto entry : strutil::tokenizer(list,",")){
+        auto [first,last] = strutil::split_view(entry,"-") ;
+        if (last.empty()){
+            last = first ;
+        }
+        
+        if (!first.empty()){
+            auto start = std::uint32_t(0) ;
+            auto finish = std::uint32_t(0) ;
+            if ((strutil::ston(first,start) != std::errc()) || (strutil::ston(last,finish) != std::errc())){
+                throw std::runtime_error("Invalid id range: "s + std::string(entry));
+            }
+            for (std::uint32_t j=start; j<=finish;j++){
+                rvalue.push_back(j);
+            }
+        }
+    }
+    return rvalue ;
+}
 
 //=================================================================================
 //=======================================================================================================================
@@ -17,19 +72,32 @@ constexpr auto hueentry_size = (32*2) + 2 + 2 +20 ;
 //=======================================================================================================================
 
 //=======================================================================================================================
-huecolor_t::huecolor_t(const std::string &value):huecolor_t() {
-    auto values = strutil::parse(value,":") ;
-    
-    switch(values.size()){
+huecolor_t::huecolor_t(std::string_view value):huecolor_t() {
+    auto values = std::array<std::string_view,3>() ;
+    auto count = size_t(0) ;
+    for (auto field : strutil::tokenizer(value,":")){
+        if (count == values.size()){
+            break;
+        }
+        values[count++] = field ;
+    }
+    auto channel = [value](std::string_view field) ->std::uint16_t {
+        auto number = std::uint16_t(0) ;
+        if (strutil::ston(field,number) != std::errc()){
+            throw std::runtime_error("Invalid color value: "s + std::string(value));
+        }
+        return number & 0x1f ;
+    };
+    switch(count){
         default:
         case 3:
-            color = color | ((strutil::ston<std::uint16_t>(values[2]))&0x1f) ;
+            color = color | channel(values[2]) ;
             [[fallthrough]];
         case 2:
-            color = color | (((strutil::ston<std::uint16_t>(values[1]))&0x1f)<<5) ;
+            color = color | (channel(values[1])<<5) ;
             [[fallthrough]];
         case 1:
-            color = color | (((strutil::ston<std::uint16_t>(values[0]))&0x1f)<<10) ;
+            color = color | (channel(values[0])<<10) ;
             [[fallthrough]];
         case 0:
             break;
@@ -59,17 +127,19 @@ auto huecolor_t::operator==(const huecolor_t &value) const ->bool {
 // hueentry_t  A hue entry
 //=======================================================================================================================
 //=======================================================================================================================
-hueentry_t::hueentry_t(const std::string &line):hueentry_t() {
-    auto values = strutil::parse(line,",") ;
-    if (values.size() != 33) {
-        std::out_of_range("Hue entry line had incorrect number of entries.");
-    }
-    huename = values[0] ;
-    if (huename.size() >20){
-        huename.resize(20);
+hueentry_t::hueentry_t(std::string_view line):hueentry_t() {
+    auto count = 0 ;
+    for (auto field : strutil::tokenizer(line,",")){
+        if (count == 0){
+            huename = std::string(field.substr(0,20)) ;
+        }
+        else if (count <= 32){
+            huecolor[count-1] = huecolor_t(field);
+        }
+        count++ ;
     }
-    for (auto j=0 ; j< 32;j++){
-        huecolor[j] = huecolor_t(values[j+1]);
+    if (count != 33) {
+        throw std::out_of_range("Hue entry line had incorrect number of entries.");
     }
     return ;
 }
@@ -78,18 +148,23 @@ hueentry_t::hueentry_t(const std::vector<std::uint8_t> &data):hueentry_t(){
     if (data.size() != hueentry_size){
         throw std::runtime_error("Hue entry data is incorrect size.");
     }
-    auto offset = 0 ;
-    for (auto j=0 ; j<32;j++){
-        std::copy(data.data()+offset,data.data()+offset+2,reinterpret_cast<std::uint8_t*>(&(huecolor[j].color)));
-        offset += 2 ;
-    }
-    auto buffer = std::vector<char>(21,0);
-    std::copy(data.data()+offset+4,data.data()+offset+4+20,reinterpret_cast<char*>(buffer.data()));
-    for (auto j = 0; j < 20; j++) {
+    *this = decode<stock_format>(data.data()) ;
+}
+//=======================================================================================================================
+template <typename Format>
+auto hueentry_t::decode(const std::uint8_t *record) ->hueentry_t {
+    auto rvalue = hueentry_t() ;
+    auto colors = std::array<std::uint16_t,Format::colorCount>() ;
+    huecodec::loadArray(record+Format::colorsOffset,colors.data(),colors.size());
+    std::copy(colors.begin(),colors.end(),rvalue.huecolor.begin());
+    auto buffer = std::vector<char>(Format::nameLength+1,0);
+    std::copy(record+Format::nameOffset,record+Format::nameOffset+Format::nameLength,buffer.data());
+    for (std::size_t j = 0; j < Format::nameLength; j++) {
           if (((buffer[j] < 32) || (buffer[j] == 44) || (buffer[j] > 127)) && (buffer[j]!=0)) {
                 buffer[j] = 45;
           }
     }
+    auto &huename = rvalue.huename ;
     huename = buffer.data() ;
     huename = strutil::trim(huename);
     // We need to ensure this doesn't have ",", or "\n", or "\r"
@@ -104,31 +179,31 @@ hueentry_t::hueentry_t(const std::vector<std::uint8_t> &data):hueentry_t(){
                 entry = '_';
           }
     }
+    return rvalue ;
 }
 //=======================================================================================================================
 auto hueentry_t::data() const ->std::vector<std::uint8_t> {
     auto buffer = std::vector<std::uint8_t>(hueentry_size,0) ;
-    auto offset = 0 ;
-    for (auto j=0 ; j<32;j++){
-        std::copy(reinterpret_cast<const std::uint8_t*>(&(huecolor[j].color)),reinterpret_cast<const std::uint8_t*>(&(huecolor[j].color))+2,buffer.data()+offset);
-        offset += 2 ;
-    }
-    // Table start
-    std::copy(reinterpret_cast<const std::uint8_t*>(&(huecolor[0].color)),reinterpret_cast<const std::uint8_t*>(&(huecolor[0].color))+2,buffer.data()+offset);
-    offset +=2 ;
-    // Table end
-    std::copy(reinterpret_cast<const std::uint8_t*>(&(huecolor[31].color)),reinterpret_cast<const std::uint8_t*>(&(huecolor[31].color))+2,buffer.data()+offset);
-    offset +=2 ;
-
-    // Name
-    auto nbuffer = std::vector<char>(20,0) ;
-    auto cpysize = std::min(huename.size(),static_cast<size_t>(20)) ;
-    std::copy(huename.c_str(),huename.c_str()+cpysize,nbuffer.data());
-    std::copy(nbuffer.data(),nbuffer.data()+nbuffer.size(),buffer.data()+offset );
-    
+    encode<stock_format>(buffer.data());
     return buffer ;
 }
 //=======================================================================================================================
+// The record must be zero filled (the name is not padded)
+template <typename Format>
+auto hueentry_t::encode(std::uint8_t *record) const ->void {
+    auto colors = std::array<std::uint16_t,Format::colorCount>() ;
+    std::transform(huecolor.begin(),huecolor.begin()+Format::colorCount,colors.begin(),[](const huecolor_t &value){
+        return value.color ;
+    });
+    huecodec::storeArray(record+Format::colorsOffset,colors.data(),colors.size());
+    // Table start and end
+    huecodec::store(record+Format::tableStartOffset,colors.front());
+    huecodec::store(record+Format::tableEndOffset,colors.back());
+    // Name
+    auto cpysize = std::min(huename.size(),Format::nameLength) ;
+    std::copy(huename.c_str(),huename.c_str()+cpysize,record+Format::nameOffset);
+}
+//=======================================================================================================================
 auto hueentry_t::description() const ->std::string {
     std::stringstream buffer ;
     buffer << huename;
@@ -184,13 +259,87 @@ auto hueentry_t::operator==(const hueentry_t& value) const ->bool {
 auto hueentry_t::operator!=(const hueentry_t& value) const ->bool {
     return !this->operator==(value);
 }
+//=======================================================================================================================
+auto hueentry_t::hash(bool includename) const ->std::uint64_t {
+    auto rvalue = std::uint64_t(0xcbf29ce484222325) ;
+    auto add = [&rvalue](std::uint8_t value){
+        rvalue = (rvalue ^ value) * std::uint64_t(0x100000001b3) ;
+    };
+    for (const auto &entry:huecolor){
+        auto color = static_cast<std::uint16_t>(entry.color & 0x7fff) ;
+        add(static_cast<std::uint8_t>(color & 0xff));
+        add(static_cast<std::uint8_t>(color >> 8));
+    }
+    if (includename){
+        for (const auto &letter:huename){
+            add(static_cast<std::uint8_t>(letter));
+        }
+    }
+    return rvalue ;
+}
 
 
 //=======================================================================================================================
 // huestorage_t
 //=======================================================================================================================
+const hueentry_t huestorage_t::blankentry = hueentry_t() ;
 const std::string huestorage_t::text_header="hueid,name,color0,color1,color2,color3,color4,color5,color6,color7,color8,color9,color10,color11,color12,color13,color14,color15,color16,color17,color18,color19,color20,color21,color22,color23,color24,color25,color26,color27,color28,color29,color30,color31" ;
 
+//=======================================================================================================================
+// Index into huedata of the id, or npos if the id is blank
+auto huestorage_t::slot(std::uint32_t id) const ->size_t {
+    auto block = id>>6 ;
+    auto bit = id&63 ;
+    if ((id >= huecount) || ((present[block] & (std::uint64_t(1)<<bit)) == 0)){
+        return std::string::npos ;
+    }
+    return rank[block] + bitsBelow(present[block],bit) ;
+}
+//=======================================================================================================================
+// Returns the stored entry for the id, inserting a blank one if it was not present
+auto huestorage_t::materialize(std::uint32_t id) ->hueentry_t& {
+    auto index = slot(id) ;
+    if (index != std::string::npos){
+        return huedata[index] ;
+    }
+    auto block = id>>6 ;
+    auto bit = id&63 ;
+    index = rank[block] + bitsBelow(present[block],bit) ;
+    present[block] |= (std::uint64_t(1)<<bit) ;
+    for (auto j = block+1 ; j<rank.size();j++){
+        rank[j]++ ;
+    }
+    return *huedata.insert(huedata.begin()+index,hueentry_t()) ;
+}
+//=======================================================================================================================
+auto huestorage_t::resize(std::uint32_t count) ->void {
+    if (count < huecount){
+        // Drop everything at or past count
+        auto block = count>>6 ;
+        if (block < present.size()){
+            present[block] &= ((std::uint64_t(1)<<(count&63))-1) ;
+            huedata.resize(rank[block] + std::bitset<64>(present[block]).count());
+        }
+    }
+    auto blocks = (static_cast<size_t>(count)+63)/64 ;
+    present.resize(blocks,0) ;
+    rank.resize(blocks,static_cast<std::uint32_t>(huedata.size())) ;
+    huecount = count ;
+}
+//=======================================================================================================================
+// Stores the entry, only materializing it if it holds data (or the id already has an entry)
+auto huestorage_t::set(std::uint32_t id,const hueentry_t &entry) ->void {
+    if (id >= huecount){
+        resize(id+1);
+    }
+    auto zero = entry.name().empty() ;
+    for (auto j = 0 ; zero && (j<32) ; j++){
+        zero = (entry[j].color == 0) ;
+    }
+    if (!zero || (slot(id) != std::string::npos)){
+        materialize(id) = entry ;
+    }
+}
 //=======================================================================================================================
 huestorage_t::huestorage_t(const std::filesystem::path &huepath,std::uint32_t maxnum):huestorage_t(maxnum){
     if (!huepath.empty()){
@@ -199,58 +348,194 @@ huestorage_t::huestorage_t(const std::filesystem::path &huepath,std::uint32_t ma
 }
 //=======================================================================================================================
 auto huestorage_t::load(const std::filesystem::path &huepath) ->void{
-    huedata.clear() ;
-    huedata.reserve(huemax) ;
+    if (isStdio(huepath)){
+        binaryStdio(stdin);
+        load(std::cin);
+        return ;
+    }
     if (!std::filesystem::exists(huepath)){
         throw std::runtime_error("Does not exist: "s + huepath.string());
     }
-    
-     auto input = std::ifstream(huepath.string(),std::ios::binary);
-    if (!input.is_open()){
-        throw std::runtime_error("Unable to open: "s + huepath.string());
+    if (isArchive(huepath)){
+        auto mul = huearchive_t(huepath).decompress() ;
+        load(mul.data(),mul.size());
+    }
+    else {
+        auto input = std::ifstream(huepath.string(),std::ios::binary);
+        if (!input.is_open()){
+            throw std::runtime_error("Unable to open: "s + huepath.string());
+        }
+        load(input);
     }
-    auto databuffer = std::vector<std::uint8_t>(hueentry_size,0);
+    // Edits not yet checkpointed into the file
+    huejournal_t::replay(huepath,*this);
+}
+//=======================================================================================================================
+template <typename Format>
+auto huestorage_t::load(std::istream &input) ->void{
+    huedata.clear() ;
+    present.clear() ;
+    rank.clear() ;
+    huecount = 0 ;
+    auto databuffer = std::vector<std::uint8_t>(Format::entrySize,0);
     auto hueid = size_t(0) ;
-    auto header = std::uint32_t(0);
+    auto header = std::array<char,Format::headerSize>();
     while (input.good() && !input.eof()){
-        if ((hueid&7) == 0){
-            input.read(reinterpret_cast<char*>(&header),4) ; // Seek past header
+        if (Format::startsGroup(hueid)){
+            input.read(header.data(),header.size()) ; // Seek past header
         }
         input.read(reinterpret_cast<char*>(databuffer.data()),databuffer.size());
-        if (input.gcount()==databuffer.size()){
+        if (input.gcount()==static_cast<std::streamsize>(databuffer.size())){
             // We read it ok
-            huedata.push_back(hueentry_t(databuffer));
-            if (huedata.size()> huemax){
+            if (huecount >= huemax){
                 throw std::runtime_error("Exceeds max number of hues of: "s + std::to_string(huemax));
             }
+            set(huecount,hueentry_t::decode<Format>(databuffer.data()));
             hueid++;
        }
     }
     
 }
 //=======================================================================================================================
+// The same as loading from a stream, for a mul already in memory
+template <typename Format>
+auto huestorage_t::load(const std::uint8_t *data,size_t size) ->void{
+    huedata.clear() ;
+    present.clear() ;
+    rank.clear() ;
+    huecount = 0 ;
+    auto offset = size_t(0) ;
+    for (auto hueid = size_t(0) ; offset < size ; hueid++){
+        if (Format::startsGroup(hueid)){
+            offset += Format::headerSize ; // Skip the header
+        }
+        if (offset + Format::entrySize > size){
+            break;
+        }
+        if (huecount >= huemax){
+            throw std::runtime_error("Exceeds max number of hues of: "s + std::to_string(huemax));
+        }
+        set(huecount,hueentry_t::decode<Format>(data+offset));
+        offset += Format::entrySize ;
+    }
+}
+//=======================================================================================================================
 auto huestorage_t::save(const std::filesystem::path &huepath) const ->void{
-    if (huedata.empty()){
+    if (huecount == 0){
         throw std::runtime_error("No hues to save.");
     }
-    auto output = std::ofstream(huepath.string(),std::ios::binary) ;
-    if (!output.is_open()){
-        throw std::runtime_error("Unable to create: "s + huepath.string());
+    if (isStdio(huepath)){
+        binaryStdio(stdout);
+        save(std::cout);
+        return ;
+    }
+    if (isArchive(huepath)){
+        auto output = std::ostringstream() ;
+        save(output);
+        auto mul = output.str() ;
+        huearchive_t(std::vector<std::uint8_t>(mul.begin(),mul.end())).save(huepath);
     }
-    auto zero = std::uint32_t(0) ;
-    for (size_t j = 0 ; j<huedata.size();j++){
-        if ((j&7) == 0){
-            output.write(reinterpret_cast<char*>(&zero),4 );
+    else {
+        auto output = std::ofstream(huepath.string(),std::ios::binary) ;
+        if (!output.is_open()){
+            throw std::runtime_error("Unable to create: "s + huepath.string());
+        }
+        save(output);
+        output.close();
+        if (output.fail()){
+            throw std::runtime_error("Unable to write: "s + huepath.string());
         }
-        output.write(reinterpret_cast<const char*>(huedata.at(j).data().data()),huedata.at(j).data().size());
     }
+    huejournal_t::discard(huepath);
 }
 //=======================================================================================================================
-auto huestorage_t::importText(const std::filesystem::path &huepath)->void{
-    auto input = std::ifstream(huepath.string()) ;
-    if (!input.is_open()){
+template <typename Format>
+auto huestorage_t::save(std::ostream &output) const ->void{
+    if (huecount == 0){
+        throw std::runtime_error("No hues to save.");
+    }
+    const auto header = std::array<char,Format::headerSize>{} ;
+    const auto blankdata = std::array<std::uint8_t,Format::entrySize>{} ;
+    auto buffer = std::array<std::uint8_t,Format::entrySize>{} ;
+    for (std::uint32_t j = 0 ; j<huecount;j++){
+        if (Format::startsGroup(j)){
+            output.write(header.data(),header.size());
+        }
+        auto index = slot(j) ;
+        if (index == std::string::npos){
+            output.write(reinterpret_cast<const char*>(blankdata.data()),blankdata.size());
+        }
+        else {
+            buffer.fill(0);
+            huedata[index].encode<Format>(buffer.data());
+            output.write(reinterpret_cast<const char*>(buffer.data()),buffer.size());
+        }
+    }
+    output.flush();
+}
+//=======================================================================================================================
+// Writes only the given ids into an existing hue mul. Ids past the end of the file are appended
+// (along with any entries between), so the file matches this storage for the given ids.
+template <typename Format>
+auto huestorage_t::save(const std::filesystem::path &huepath,const std::vector<std::uint32_t> &ids) const ->void{
+    if (!std::filesystem::exists(huepath)){
+        throw std::runtime_error("Does not exist: "s + huepath.string());
+    }
+    if (isArchive(huepath) || std::filesystem::exists(huejournal_t::path(huepath))){
+        // An archive can't be patched in place, and a mul with a journal is missing the journal's
+        // edits on disk, so either is written whole
+        if constexpr (std::is_same_v<Format,stock_format>){
+            save(huepath);
+        }
+        else {
+            auto output = std::ofstream(huepath.string(),std::ios::binary) ;
+            if (!output.is_open()){
+                throw std::runtime_error("Unable to create: "s + huepath.string());
+            }
+            save<Format>(output);
+            output.close();
+            huejournal_t::discard(huepath);
+        }
+        return ;
+    }
+    auto existing = Format::entryCount(std::filesystem::file_size(huepath)) ;
+    const auto header = std::array<char,Format::headerSize>{} ;
+    auto buffer = std::array<std::uint8_t,Format::entrySize>{} ;
+    auto encode = [this,&buffer](std::uint32_t id){
+        buffer.fill(0);
+        (*this)[id].template encode<Format>(buffer.data());
+        return reinterpret_cast<const char*>(buffer.data()) ;
+    };
+    auto output = std::fstream(huepath.string(),std::ios::binary|std::ios::in|std::ios::out) ;
+    if (!output.is_open()){
         throw std::runtime_error("Unable to open: "s + huepath.string());
     }
+    auto largest = existing ;
+    for (const auto &id:ids){
+        if (id < existing){
+            output.seekp(Format::entryOffset(id));
+            output.write(encode(id),buffer.size());
+        }
+        else {
+            largest = std::max<std::uint64_t>(largest,std::uint64_t(id)+1);
+        }
+    }
+    if (largest > existing){
+        output.seekp(Format::entryOffset(existing) - (Format::startsGroup(existing) ? Format::headerSize : 0));
+        for (auto j = existing ; j<largest;j++){
+            if (Format::startsGroup(j)){
+                output.write(header.data(),header.size());
+            }
+            output.write(encode(static_cast<std::uint32_t>(j)),buffer.size());
+        }
+    }
+    if (!output.good()){
+        throw std::runtime_error("Unable to write: "s + huepath.string());
+    }
+}
+//=======================================================================================================================
+// Reads the hue csv, calling the function with the id and remaining text of each hue line
+auto readText(std::istream &input,const std::function<void(std::uint32_t,std::string_view)> &process) ->void {
     auto buffer = std::vector<char>(4049,0) ;
     auto linecount = 0 ;
     while (input.good() && !input.eof()){
@@ -259,23 +544,14 @@ auto huestorage_t::importText(const std::filesystem::path &huepath)->void{
         if (input.gcount()>0){
             // This might have the \n or not, who knows
             buffer[input.gcount()] = 0 ;
-            std::string line = std::string(buffer.data(),buffer.data()+input.gcount()) ;
-            line = strutil::trim(line);
+            auto line = strutil::trim_view(std::string_view(buffer.data())) ;
             if (!line.empty()){
-                auto [first,rest] = strutil::split(line, ",");
-                if (strutil::lower(first) != "hueid"){
+                auto [first,rest] = strutil::split_view(line, ",");
+                if (!strutil::iequal(first,"hueid")){
                     // Ok, so the first is the hue id, and the rest is the huedata
-                    auto id = strutil::ston<std::uint32_t>(first) ;
-                    if (!rest.empty()){
-                        auto needed = id +1 ;
-                        if (needed > huedata.size()){
-                            // Ok, so we need to increase the data size, check to see if exceeds
-                            huedata.resize(needed);
-                            if (huedata.size()> huemax){
-                                throw std::runtime_error("Exceeds max number of hues of: "s + std::to_string(huemax));
-                            }
-                        }
-                        huedata[id]= hueentry_t(rest);
+                    auto id = std::uint32_t(0) ;
+                    if (!rest.empty() && (strutil::ston(first,id) == std::errc())){
+                        process(id,rest);
                     }
                     else {
                         throw std::runtime_error("Bad line on line number: "s+std::to_string(linecount));
@@ -287,54 +563,281 @@ auto huestorage_t::importText(const std::filesystem::path &huepath)->void{
     }
 }
 //=======================================================================================================================
+// Opens the csv (or stdin for "-"), and reads it with readText
+auto readText(const std::filesystem::path &huepath,const std::function<void(std::uint32_t,std::string_view)> &process) ->void {
+    if (isStdio(huepath)){
+        readText(std::cin,process);
+        return ;
+    }
+    auto input = std::ifstream(huepath.string()) ;
+    if (!input.is_open()){
+        throw std::runtime_error("Unable to open: "s + huepath.string());
+    }
+    readText(input,process);
+}
+//=======================================================================================================================
+auto huestorage_t::importText(const std::filesystem::path &huepath)->void{
+    if (isStdio(huepath)){
+        importText(std::cin);
+        return ;
+    }
+    auto input = std::ifstream(huepath.string()) ;
+    if (!input.is_open()){
+        throw std::runtime_error("Unable to open: "s + huepath.string());
+    }
+    importText(input);
+}
+//=======================================================================================================================
+auto huestorage_t::importText(std::istream &input)->void{
+    readText(input, [this](std::uint32_t id,std::string_view rest){
+        auto needed = id +1 ;
+        if (needed > huecount){
+            // Ok, so we need to increase the data size, check to see if exceeds
+            if (needed> huemax){
+                throw std::runtime_error("Exceeds max number of hues of: "s + std::to_string(huemax));
+            }
+        }
+        set(id,hueentry_t(rest));
+    });
+}
+//=======================================================================================================================
+// Applies the csv to the existing hues. Each line is hashed and compared with the hash of the
+// existing entry's text, so only lines that differ are parsed. Returns the ids that changed.
+auto huestorage_t::updateText(const std::filesystem::path &huepath)->std::vector<std::uint32_t>{
+    auto hasher = std::hash<std::string_view>() ;
+    auto hashes = std::vector<size_t>() ;
+    hashes.reserve(huecount);
+    auto blankhash = hasher(blankentry.description()) ;
+    for (std::uint32_t j = 0 ; j<huecount;j++){
+        auto index = slot(j) ;
+        hashes.push_back(index == std::string::npos ? blankhash : hasher(huedata[index].description()));
+    }
+    auto rvalue = std::vector<std::uint32_t>() ;
+    // The hashes follow each row as it is applied, so a later row for the same id is compared with
+    // the earlier one (the last row wins, as with importText). The original of each changed entry
+    // is kept, to drop ids that end up back where they started.
+    auto originals = std::map<std::uint32_t,std::vector<std::uint8_t>>() ;
+    const auto originalcount = huecount ;
+    readText(huepath, [this,&hasher,&hashes,&rvalue,&originals,originalcount,blankhash](std::uint32_t id,std::string_view rest){
+        auto hash = hasher(rest) ;
+        if ((id < hashes.size()) && (hashes[id] == hash)){
+            return ;
+        }
+        auto entry = hueentry_t(rest) ;
+        auto needed = id +1 ;
+        if (needed > huecount){
+            if (needed> huemax){
+                throw std::runtime_error("Exceeds max number of hues of: "s + std::to_string(huemax));
+            }
+        }
+        else if (std::as_const(*this)[id].data() == entry.data()){
+            // Formatted differently, but the same hue
+            hashes[id] = hash ;
+            return ;
+        }
+        if ((id < originalcount) && (originals.find(id) == originals.end())){
+            originals[id] = std::as_const(*this)[id].data() ;
+        }
+        set(id,entry) ;
+        if (id >= hashes.size()){
+            hashes.resize(needed,blankhash);
+        }
+        hashes[id] = hash ;
+        rvalue.push_back(id);
+    });
+    std::sort(rvalue.begin(),rvalue.end());
+    rvalue.erase(std::unique(rvalue.begin(),rvalue.end()),rvalue.end());
+    rvalue.erase(std::remove_if(rvalue.begin(),rvalue.end(),[this,&originals](std::uint32_t id){
+        auto iter = originals.find(id) ;
+        return (iter != originals.end()) && (std::as_const(*this)[id].data() == iter->second) ;
+    }),rvalue.end());
+    return rvalue ;
+}
+//=======================================================================================================================
 auto huestorage_t::exportText(const std::filesystem::path &huepath) const ->void {
+    if (isStdio(huepath)){
+        exportText(std::cout);
+        return ;
+    }
     auto output = std::ofstream(huepath.string());
     if (!output.is_open()){
         throw std::runtime_error("Unable to create: "s+huepath.string());
     }
+    exportText(output);
+}
+//=======================================================================================================================
+auto huestorage_t::exportText(std::ostream &output) const ->void {
     output << huestorage_t::text_header<<"\n" ;
-    auto hueid = 0 ;
-    for (const auto &entry:huedata){
-        output <<std::to_string(hueid)<<","<<entry.description()<<"\n" ;
-        hueid++;
+    for (std::uint32_t hueid = 0 ; hueid<huecount;hueid++){
+        output <<std::to_string(hueid)<<","<<(*this)[hueid].description()<<"\n" ;
     }
-    
+    output.flush();
+}
+//=======================================================================================================================
+// Converts a hue mul to csv one HueGroup at a time, so memory use does not grow with the table
+template <typename Format>
+auto huestorage_t::streamText(std::istream &input,std::ostream &output,std::uint32_t maxnum) ->void {
+    output << huestorage_t::text_header<<"\n" ;
+    auto databuffer = std::vector<std::uint8_t>(Format::entrySize,0);
+    auto header = std::array<char,Format::headerSize>();
+    auto hueid = std::uint32_t(0) ;
+    while (input.good() && !input.eof()){
+        if (Format::startsGroup(hueid)){
+            input.read(header.data(),header.size()) ; // Seek past header
+        }
+        input.read(reinterpret_cast<char*>(databuffer.data()),databuffer.size());
+        if (input.gcount()==static_cast<std::streamsize>(databuffer.size())){
+            if (hueid >= maxnum){
+                throw std::runtime_error("Exceeds max number of hues of: "s + std::to_string(maxnum));
+            }
+            output <<std::to_string(hueid)<<","<<hueentry_t::decode<Format>(databuffer.data()).description()<<"\n" ;
+            hueid++;
+        }
+    }
+    output.flush();
+}
+//=======================================================================================================================
+auto huestorage_t::streamText(const std::filesystem::path &huepath,const std::filesystem::path &csvpath,std::uint32_t maxnum) ->void {
+    auto input = std::ifstream() ;
+    auto archive = std::istringstream() ;
+    auto output = std::ofstream() ;
+    if (!isStdio(huepath) && std::filesystem::exists(huejournal_t::path(huepath))){
+        // The journal has to be applied over the whole table
+        auto hues = huestorage_t(huepath,maxnum) ;
+        hues.exportText(csvpath);
+        return ;
+    }
+    if (isStdio(huepath)){
+        binaryStdio(stdin);
+    }
+    else if (isArchive(huepath)){
+        auto mul = huearchive_t(huepath).decompress() ;
+        archive.str(std::string(mul.begin(),mul.end()));
+    }
+    else {
+        if (!std::filesystem::exists(huepath)){
+            throw std::runtime_error("Does not exist: "s + huepath.string());
+        }
+        input.open(huepath.string(),std::ios::binary);
+        if (!input.is_open()){
+            throw std::runtime_error("Unable to open: "s + huepath.string());
+        }
+    }
+    if (!isStdio(csvpath)){
+        output.open(csvpath.string());
+        if (!output.is_open()){
+            throw std::runtime_error("Unable to create: "s+csvpath.string());
+        }
+    }
+    auto &source = isStdio(huepath) ? std::cin : (isArchive(huepath) ? static_cast<std::istream&>(archive) : static_cast<std::istream&>(input)) ;
+    streamText(source, isStdio(csvpath) ? std::cout : static_cast<std::ostream&>(output), maxnum);
+}
+//=======================================================================================================================
+// Converts a csv to a hue mul one HueGroup at a time. Only one group is held in memory, so the csv
+// ids must ascend group by group (as exportText writes them). Missing ids are written blank.
+template <typename Format>
+auto huestorage_t::streamMul(std::istream &input,std::ostream &output,std::uint32_t maxnum) ->void {
+    constexpr auto perGroup = static_cast<std::uint32_t>(Format::entriesPerGroup) ;
+    auto group = std::vector<hueentry_t>(perGroup) ;
+    auto groupnumber = std::uint32_t(0) ;
+    auto highest = std::uint32_t(0) ;
+    auto any = false ;
+    auto writeGroup = [&group,&output](size_t count){
+        const auto header = std::array<char,Format::headerSize>{} ;
+        auto buffer = std::array<std::uint8_t,Format::entrySize>{} ;
+        output.write(header.data(),header.size());
+        for (size_t j = 0 ; j<count;j++){
+            buffer.fill(0);
+            group[j].template encode<Format>(buffer.data());
+            output.write(reinterpret_cast<const char*>(buffer.data()),buffer.size());
+            group[j] = hueentry_t() ;
+        }
+    };
+    readText(input, [&](std::uint32_t id,std::string_view rest){
+        if ((id +1) > maxnum){
+            throw std::runtime_error("Exceeds max number of hues of: "s + std::to_string(maxnum));
+        }
+        if ((id/perGroup) < groupnumber){
+            throw std::runtime_error("Streamed csv ids must be ascending, out of order id: "s + std::to_string(id));
+        }
+        while ((id/perGroup) > groupnumber){
+            writeGroup(group.size());
+            groupnumber++ ;
+        }
+        group[id%perGroup] = hueentry_t(rest) ;
+        highest = std::max(highest,id) ;
+        any = true ;
+    });
+    if (!any){
+        throw std::runtime_error("No hues to save.");
+    }
+    writeGroup((highest%perGroup)+1);
+    output.flush();
+}
+//=======================================================================================================================
+auto huestorage_t::streamMul(const std::filesystem::path &csvpath,const std::filesystem::path &huepath,std::uint32_t maxnum) ->void {
+    auto input = std::ifstream() ;
+    auto output = std::ofstream() ;
+    if (!isStdio(csvpath)){
+        input.open(csvpath.string());
+        if (!input.is_open()){
+            throw std::runtime_error("Unable to open: "s + csvpath.string());
+        }
+    }
+    if (isStdio(huepath)){
+        binaryStdio(stdout);
+    }
+    else {
+        output.open(huepath.string(),std::ios::binary);
+        if (!output.is_open()){
+            throw std::runtime_error("Unable to create: "s + huepath.string());
+        }
+    }
+    streamMul(isStdio(csvpath) ? std::cin : static_cast<std::istream&>(input), isStdio(huepath) ? std::cout : static_cast<std::ostream&>(output), maxnum);
+    huejournal_t::discard(huepath);
 }
 
 //=======================================================================================================================
 auto huestorage_t::size() const ->size_t{
-    return huedata.size() ;
+    return huecount ;
 }
 //=======================================================================================================================
 auto huestorage_t::operator[](std::uint32_t id) const ->const hueentry_t& {
-    return huedata.at(id) ;
+    if (id >= huecount){
+        throw std::out_of_range("Hue id exceeds the number of hues: "s + std::to_string(id));
+    }
+    auto index = slot(id) ;
+    return index == std::string::npos ? blankentry : huedata[index] ;
 }
 //=======================================================================================================================
 auto huestorage_t::operator[](std::uint32_t id)  -> hueentry_t& {
-    return huedata.at(id) ;
+    if (id >= huecount){
+        throw std::out_of_range("Hue id exceeds the number of hues: "s + std::to_string(id));
+    }
+    return materialize(id) ;
 }
 //=======================================================================================================================
 auto huestorage_t::empty() const->bool {
-    return huedata.empty() ;
+    return huecount == 0 ;
 }
 
 //=======================================================================================================================
 auto huestorage_t::blank() const ->std::vector<std::uint32_t> {
     auto rvalue = std::vector<std::uint32_t>() ;
-    auto hueid = 0 ;
-    for (const auto &entry:huedata){
-        if (entry.empty()){
+    for (std::uint32_t hueid = 0 ; hueid<huecount;hueid++){
+        auto index = slot(hueid) ;
+        if ((index == std::string::npos) || huedata[index].empty()){
                 rvalue.push_back(hueid);
         }
-        hueid++ ;
     }
     return rvalue ;
 }
 //=======================================================================================================================
 auto huestorage_t::unique(const huestorage_t &storage) const ->std::vector<std::uint32_t> {
     auto rvalue = std::vector<std::uint32_t>() ;
-    auto hueid = 0 ;
-    for (const auto &entry:storage.huedata) {
+    // Blank entries never hold a non empty hue, so only the stored entries need to be checked
+    for (std::uint32_t hueid = 0 ; hueid<storage.huecount;hueid++) {
+        const auto &entry = storage[hueid] ;
         if (!entry.empty()){
             auto match = false ;
            
@@ -348,7 +851,22 @@ auto huestorage_t::unique(const huestorage_t &storage) const ->std::vector<std::
                 rvalue.push_back(hueid);
             }
         }
-        hueid++;
+    }
+    return rvalue ;
+}
+//=======================================================================================================================
+// Returns the ids whose entry differs between the two storages, including ids only present in one of them
+auto huestorage_t::changed(const huestorage_t &storage) const ->std::vector<std::uint32_t> {
+    auto rvalue = std::vector<std::uint32_t>() ;
+    auto common = std::min(huecount,storage.huecount) ;
+    for (std::uint32_t j = 0 ; j<common;j++){
+        if ((*this)[j] != storage[j]){
+            rvalue.push_back(j);
+        }
+    }
+    auto largest = std::max(huecount,storage.huecount) ;
+    for (auto j = common ; j<largest;j++){
+        rvalue.push_back(static_cast<std::uint32_t>(j));
     }
     return rvalue ;
 }
@@ -365,13 +883,13 @@ auto huestorage_t::merge(const huestorage_t &storage)  ->void {
             auto iter = blanks.begin() ;
             for (const auto &id:unique){
                 if (iter != blanks.end()){
-                    std::cout <<"Inserting addition id:"<<id<<" into empty id "<<*iter<<std::endl;
-                    huedata[*iter] = storage[id] ;
+                    std::clog <<"Inserting addition id:"<<id<<" into empty id "<<*iter<<std::endl;
+                    set(*iter,storage[id]) ;
                     iter++ ;
                 }
                 else {
                     auto temp = this->append(storage[id]) ;
-                    std::cout <<"Expanding for "<<id<<" placed at id "<<temp<<std::endl;
+                    std::clog <<"Expanding for "<<id<<" placed at id "<<temp<<std::endl;
                 }
             }
         }
@@ -384,9 +902,24 @@ auto huestorage_t::merge(const huestorage_t &storage)  ->void {
 
 //=======================================================================================================================
 auto huestorage_t::append(const hueentry_t &entry)->std::uint32_t {
-    if (huedata.size()>=huemax) {
+    if (huecount>=huemax) {
         throw std::runtime_error("Adding an entry would exceed max number of hues: "s+std::to_string(huemax));
     }
-    huedata.push_back(entry) ;
-    return static_cast<std::uint32_t>(huedata.size()-1) ;
+    set(huecount,entry) ;
+    return huecount-1 ;
 }
+
+//=======================================================================================================================
+// The formats the codec is instantiated for (another layout is added here as one more line each)
+//=======================================================================================================================
+#define HUE_INSTANTIATE_FORMAT(Format) \
+    template auto hueentry_t::decode<Format>(const std::uint8_t *record) ->hueentry_t ; \
+    template auto hueentry_t::encode<Format>(std::uint8_t *record) const ->void ; \
+    template auto huestorage_t::load<Format>(std::istream &input) ->void ; \
+    template auto huestorage_t::load<Format>(const std::uint8_t *data,size_t size) ->void ; \
+    template auto huestorage_t::save<Format>(std::ostream &output) const ->void ; \
+    template auto huestorage_t::save<Format>(const std::filesystem::path &huepath,const std::vector<std::uint32_t> &ids) const ->void ; \
+    template auto huestorage_t::streamText<Format>(std::istream &input,std::ostream &output,std::uint32_t maxnum) ->void ; \
+    template auto huestorage_t::streamMul<Format>(std::istream &input,std::ostream &output,std::uint32_t maxnum) ->void ;
+
+HUE_INSTANTIATE_FORMAT(stock_format)
@@ -4,13 +4,19 @@
 #define huedata_hpp
 
 #include <cstdint>
+#include <cstddef>
 #include <string>
+#include <string_view>
 #include <array>
 #include <vector>
 #include <map>
 #include <istream>
+#include <ostream>
+#include <cstdio>
 #include <filesystem>
 
+#include "hueformat.hpp"
+
 //=================================================================================
 /*
  3.7 HUES.MUL
@@ -30,6 +36,27 @@
  DWORD Header;
  HueEntry Entries[8];
  */
+inline constexpr auto hueentry_size = stock_format::entrySize ;
+inline constexpr auto huegroup_size = stock_format::groupSize ;
+
+//=================================================================================
+// Offset of a hue entry in a stock mul, and the number of entries a stock mul of the given size holds
+constexpr auto entryOffset(std::uint64_t id) ->std::uint64_t {
+    return stock_format::entryOffset(id) ;
+}
+constexpr auto entryCount(std::uint64_t filesize) ->std::uint64_t {
+    return stock_format::entryCount(filesize) ;
+}
+
+//=======================================================================================================================
+// A path of "-" is stdin when reading, and stdout when writing
+auto isStdio(const std::filesystem::path &huepath) ->bool ;
+auto binaryStdio(std::FILE *file) ->void ;
+
+//=================================================================================
+// A list of ids and inclusive id ranges, such as 1,5,10-20
+auto determine_ids(const std::string& list) ->std::vector<std::uint32_t> ;
+
 //=======================================================================================================================
 // huecolor_t  a hue color value
 //=======================================================================================================================
@@ -37,7 +64,7 @@
 struct huecolor_t {
     std::uint16_t color ;
     huecolor_t(std::uint16_t value =0):color(value){}
-    huecolor_t(const std::string &value) ;
+    huecolor_t(std::string_view value) ;
     auto description() const ->std::string ;
     auto empty() const ->bool ;
     auto operator!=(const huecolor_t &value) const ->bool ;
@@ -56,11 +83,16 @@ public:
     hueentry_t() = default;
     // Format of line: namestring,r:g:b,...repeated 32 times
     // the rgb values are 5 bits, so go betwen 0,31
-    hueentry_t(const std::string &line) ;
+    hueentry_t(std::string_view line) ;
     
     hueentry_t(const std::vector<std::uint8_t> &data);
     
     auto data() const ->std::vector<std::uint8_t> ;
+    // A record of the given format
+    template <typename Format>
+    static auto decode(const std::uint8_t *record) ->hueentry_t ;
+    template <typename Format>
+    auto encode(std::uint8_t *record) const ->void ;
     auto description() const ->std::string ;
 
     auto empty() const ->bool ;
@@ -72,31 +104,72 @@ public:
     
     auto operator!=(const hueentry_t& value) const ->bool ;
     auto operator==(const hueentry_t& value) const ->bool ;
+    // FNV-1a over the masked colors (and the name), so entries that compare equal hash equal.
+    // Without the name it identifies the ramp alone.
+    auto hash(bool includename=true) const ->std::uint64_t ;
 
 };
 
 //=======================================================================================================================
 // huestorage_t  
 //=======================================================================================================================
+// Storage is sparse, only entries that hold data are kept. present is a bitmap over the ids,
+// and huedata holds the present entries packed in id order. rank holds the number of present
+// entries before each 64 id block of the bitmap. Blank entries are only materialised when
+// written to a file, or when a mutable reference is requested.
 class huestorage_t {
+    std::vector<std::uint64_t> present ;
+    std::vector<std::uint32_t> rank ;
     std::vector<hueentry_t> huedata ;
+    std::uint32_t huecount ;
     std::uint32_t huemax ;
+    static const hueentry_t blankentry ;
+    
+    auto slot(std::uint32_t id) const ->size_t ;
+    auto materialize(std::uint32_t id) ->hueentry_t& ;
+    auto resize(std::uint32_t count) ->void ;
+    auto set(std::uint32_t id,const hueentry_t &entry) ->void ;
 public:
     static const std::string text_header ;
-    huestorage_t(std::uint32_t maxnum=3000):huemax(maxnum){}
+    huestorage_t(std::uint32_t maxnum=3000):huecount(0),huemax(maxnum){}
     huestorage_t(const std::filesystem::path &huepath,std::uint32_t maxnum=3000) ;
     auto load(const std::filesystem::path &huepath) ->void ;
+    // The stream and in place versions (and hueentry_t::decode/encode) are templates over the hue format
+    // (see hueformat.hpp), but they are defined in huedata.cpp and only instantiated there, with
+    // HUE_INSTANTIATE_FORMAT. Any other format must be added there (one line), or it fails to link.
+    template <typename Format=stock_format>
+    auto load(std::istream &input) ->void ;
+    template <typename Format=stock_format>
+    auto load(const std::uint8_t *data,size_t size) ->void ;
     auto save(const std::filesystem::path &huepath) const ->void;
+    template <typename Format=stock_format>
+    auto save(std::ostream &output) const ->void;
+    template <typename Format=stock_format>
+    auto save(const std::filesystem::path &huepath,const std::vector<std::uint32_t> &ids) const ->void;
     auto importText(const std::filesystem::path &huepath) ->void;
+    auto importText(std::istream &input) ->void;
+    auto updateText(const std::filesystem::path &huepath) ->std::vector<std::uint32_t>;
     auto exportText(const std::filesystem::path &huepath) const ->void;
+    auto exportText(std::ostream &output) const ->void;
+    
+    // Constant memory conversions, one HueGroup at a time
+    template <typename Format=stock_format>
+    static auto streamText(std::istream &input,std::ostream &output,std::uint32_t maxnum=3000) ->void ;
+    static auto streamText(const std::filesystem::path &huepath,const std::filesystem::path &csvpath,std::uint32_t maxnum=3000) ->void ;
+    template <typename Format=stock_format>
+    static auto streamMul(std::istream &input,std::ostream &output,std::uint32_t maxnum=3000) ->void ;
+    static auto streamMul(const std::filesystem::path &csvpath,const std::filesystem::path &huepath,std::uint32_t maxnum=3000) ->void ;
     
     auto size() const ->size_t ;
     auto operator[](std::uint32_t id) const ->const hueentry_t& ;
+    // For writing: a blank id is materialized (an insert into huedata, linear in the entries held),
+    // which invalidates references returned earlier. Read through a const table (std::as_const).
     auto operator[](std::uint32_t id) -> hueentry_t& ;
     auto empty() const ->bool ;
     
     auto blank() const ->std::vector<std::uint32_t> ;
     auto unique(const huestorage_t &storage) const ->std::vector<std::uint32_t> ;
+    auto changed(const huestorage_t &storage) const ->std::vector<std::uint32_t> ;
     auto merge(const huestorage_t &storage)  ->void ;
     auto append(const hueentry_t &entry) ->std::uint32_t ;
 };
@@ -0,0 +1,138 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#include "huefind.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+#include "strutil.hpp"
+
+using namespace std::string_literals;
+
+//=======================================================================================================================
+// hueindex_t
+//=======================================================================================================================
+
+//=======================================================================================================================
+// The index holds positions into names (not ids), so the posting lists stay small and in order
+hueindex_t::hueindex_t(const huestorage_t &storage){
+    for (std::uint32_t id = 0 ; id<storage.size();id++){
+        const auto &name = storage[id].name() ;
+        if (name.empty()){
+            continue;
+        }
+        ids.push_back(id);
+        names.push_back(name);
+        folded.push_back(strutil::lower(name));
+    }
+    sorted.resize(names.size());
+    for (std::uint32_t j = 0 ; j<sorted.size();j++){
+        sorted[j] = j ;
+    }
+    std::sort(sorted.begin(),sorted.end(),[this](std::uint32_t lhs,std::uint32_t rhs){
+        return folded[lhs] < folded[rhs] ;
+    });
+    for (std::uint32_t j = 0 ; j<folded.size();j++){
+        for (size_t offset = 0 ; offset+3 <= folded[j].size();offset++){
+            auto &list = trigrams[trigram(folded[j],offset)] ;
+            if (list.empty() || (list.back() != j)){
+                list.push_back(j);
+            }
+        }
+    }
+}
+//=======================================================================================================================
+auto hueindex_t::trigram(std::string_view text,size_t offset) ->std::uint32_t {
+    return (std::uint32_t(static_cast<unsigned char>(text[offset]))<<16) | (std::uint32_t(static_cast<unsigned char>(text[offset+1]))<<8) | std::uint32_t(static_cast<unsigned char>(text[offset+2])) ;
+}
+//=======================================================================================================================
+// Glob match, backtracking to the last * on a mismatch
+auto hueindex_t::match(std::string_view pattern,std::string_view name) ->bool {
+    auto p = size_t(0) ;
+    auto n = size_t(0) ;
+    auto star = std::string_view::npos ;
+    auto resume = size_t(0) ;
+    while (n < name.size()){
+        if ((p < pattern.size()) && ((pattern[p] == '?') || (pattern[p] == name[n]))){
+            p++ ;
+            n++ ;
+        }
+        else if ((p < pattern.size()) && (pattern[p] == '*')){
+            star = p++ ;
+            resume = n ;
+        }
+        else if (star != std::string_view::npos){
+            p = star + 1 ;
+            n = ++resume ;
+        }
+        else {
+            return false ;
+        }
+    }
+    while ((p < pattern.size()) && (pattern[p] == '*')){
+        p++ ;
+    }
+    return p == pattern.size() ;
+}
+//=======================================================================================================================
+auto hueindex_t::find(std::string_view pattern,bool ignorecase) const ->std::vector<std::uint32_t> {
+    auto lowered = strutil::lower(std::string(pattern)) ;
+    // Candidates are positions into names, narrowed first by the literal prefix, then by each trigram
+    auto candidates = std::vector<std::uint32_t>() ;
+    auto constrained = false ;
+    auto literal = lowered.find_first_of("*?") ;
+    auto prefix = std::string_view(lowered).substr(0,literal) ;
+    if (!prefix.empty()){
+        auto first = std::lower_bound(sorted.begin(),sorted.end(),prefix,[this](std::uint32_t position,std::string_view value){
+            return std::string_view(folded[position]).substr(0,value.size()) < value ;
+        });
+        auto last = std::upper_bound(first,sorted.end(),prefix,[this](std::string_view value,std::uint32_t position){
+            return value < std::string_view(folded[position]).substr(0,value.size()) ;
+        });
+        candidates.assign(first,last);
+        std::sort(candidates.begin(),candidates.end());
+        constrained = true ;
+    }
+    auto runs = std::vector<std::string_view>() ;
+    for (size_t start = 0 ; start < lowered.size();){
+        auto end = std::min(lowered.find_first_of("*?",start),lowered.size()) ;
+        runs.push_back(std::string_view(lowered).substr(start,end-start));
+        start = end + 1 ;
+    }
+    for (auto run : runs){
+        for (size_t offset = 0 ; offset+3 <= run.size();offset++){
+            auto iter = trigrams.find(trigram(run,offset)) ;
+            if (iter == trigrams.end()){
+                return std::vector<std::uint32_t>() ;
+            }
+            if (!constrained){
+                candidates = iter->second ;
+                constrained = true ;
+                continue;
+            }
+            auto narrowed = std::vector<std::uint32_t>() ;
+            std::set_intersection(candidates.begin(),candidates.end(),iter->second.begin(),iter->second.end(),std::back_inserter(narrowed));
+            candidates = std::move(narrowed) ;
+            if (candidates.empty()){
+                return candidates ;
+            }
+        }
+    }
+    if (!constrained){
+        candidates.resize(names.size());
+        for (std::uint32_t j = 0 ; j<candidates.size();j++){
+            candidates[j] = j ;
+        }
+    }
+    auto rvalue = std::vector<std::uint32_t>() ;
+    for (const auto &position:candidates){
+        if (ignorecase ? match(lowered,folded[position]) : match(pattern,names[position])){
+            rvalue.push_back(ids[position]);
+        }
+    }
+    return rvalue ;
+}
+//=======================================================================================================================
+auto hueindex_t::size() const ->size_t {
+    return ids.size() ;
+}
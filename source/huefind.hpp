@@ -0,0 +1,39 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#ifndef huefind_hpp
+#define huefind_hpp
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+
+#include "huedata.hpp"
+
+//=======================================================================================================================
+// hueindex_t  A name index over a hue table, built once and then queried any number of times.
+// Patterns are globs over the (sanitised, trimmed) entry names: * matches any run of characters
+// and ? any one character, so "ice*" is a prefix query, "*dye*" a substring query, and a pattern
+// without wildcards is an exact match. Only entries with a name are indexed.
+// A literal prefix is answered from the names sorted in lower case. Otherwise each literal run of
+// three or more characters selects the ids that hold all of its trigrams, and only those candidates
+// are matched against the pattern.
+//=======================================================================================================================
+class hueindex_t {
+    std::vector<std::uint32_t> ids ;
+    std::vector<std::string> names ;
+    std::vector<std::string> folded ;
+    std::vector<std::uint32_t> sorted ;
+    std::unordered_map<std::uint32_t,std::vector<std::uint32_t>> trigrams ;
+
+    static auto trigram(std::string_view text,size_t offset) ->std::uint32_t ;
+    static auto match(std::string_view pattern,std::string_view name) ->bool ;
+public:
+    hueindex_t(const huestorage_t &storage) ;
+    // Returns the matching ids, in id order
+    auto find(std::string_view pattern,bool ignorecase=true) const ->std::vector<std::uint32_t> ;
+    auto size() const ->size_t ;
+};
+
+#endif /* huefind_hpp */
@@ -0,0 +1,129 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#include "huefit.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+#include "colorspace.hpp"
+#include "parallel.hpp"
+
+using namespace std::string_literals;
+
+//=======================================================================================================================
+// The 5 bit channel nearest to a linear light value
+inline auto nearestChannel(double value) ->std::uint16_t {
+    auto iter = std::lower_bound(colorspace::linear.begin(),colorspace::linear.end(),static_cast<float>(value)) ;
+    if (iter == colorspace::linear.end()){
+        return 31 ;
+    }
+    auto upper = static_cast<std::uint16_t>(iter - colorspace::linear.begin()) ;
+    if ((upper > 0) && ((value - colorspace::linear[upper-1]) < (colorspace::linear[upper] - value))){
+        return upper - 1 ;
+    }
+    return upper ;
+}
+
+//=======================================================================================================================
+auto fitRamp(const image_t &image,const std::string &name,bool threaded) ->hueentry_t {
+    auto pixelcount = std::size_t(image.width)*image.height ;
+    auto histogram = std::vector<std::uint64_t>(32768,0) ;
+    auto count = [&image](std::vector<std::uint64_t> &counts,std::size_t first,std::size_t last){
+        for (auto j = first ; j<last;j++){
+            auto pixel = image.pixels.data() + (j*3) ;
+            counts[((pixel[0]>>3)<<10) | ((pixel[1]>>3)<<5) | (pixel[2]>>3)]++ ;
+        }
+    };
+    if (threaded){
+        auto partials = std::vector<std::vector<std::uint64_t>>(parallel::threads(pixelcount/65536 + 1),std::vector<std::uint64_t>(32768,0)) ;
+        auto chunks = partials.size() ;
+        parallel::forEach(chunks, [&count,&partials,pixelcount,chunks](std::size_t first,std::size_t last,std::size_t){
+            for (auto chunk = first ; chunk<last;chunk++){
+                count(partials[chunk],(pixelcount*chunk)/chunks,(pixelcount*(chunk+1))/chunks);
+            }
+        });
+        for (const auto &partial:partials){
+            for (std::size_t j = 0 ; j<histogram.size();j++){
+                histogram[j] += partial[j] ;
+            }
+        }
+    }
+    else {
+        count(histogram,0,pixelcount);
+    }
+    auto colors = std::vector<std::uint16_t>() ;
+    for (std::uint16_t color = 0 ; color<32768;color++){
+        if (histogram[color] > 0){
+            colors.push_back(color);
+        }
+    }
+    std::stable_sort(colors.begin(),colors.end(),[](std::uint16_t lhs,std::uint16_t rhs){
+        return colorspace::luminance(lhs) < colorspace::luminance(rhs) ;
+    });
+    // Walk the sorted colors, splitting a color's pixels between quantiles where it straddles them
+    auto sums = std::array<std::array<double,3>,32>{} ;
+    auto weights = std::array<double,32>{} ;
+    auto share = static_cast<double>(pixelcount)/32.0 ;
+    auto step = std::size_t(0) ;
+    for (const auto &color:colors){
+        auto remaining = static_cast<double>(histogram[color]) ;
+        while ((remaining > 0.0) && (step < 32)){
+            auto amount = std::min(remaining,share - weights[step]) ;
+            sums[step][0] += amount*colorspace::linear[colorspace::red(color)] ;
+            sums[step][1] += amount*colorspace::linear[colorspace::green(color)] ;
+            sums[step][2] += amount*colorspace::linear[colorspace::blue(color)] ;
+            weights[step] += amount ;
+            remaining -= amount ;
+            if (weights[step] >= share*0.999999){
+                step++ ;
+            }
+        }
+    }
+    auto rvalue = hueentry_t() ;
+    for (auto j = 0 ; j<32;j++){
+        // Floating point can leave the last quantile a hair short
+        auto weight = std::max(weights[j],1e-12) ;
+        rvalue[j] = huecolor_t(static_cast<std::uint16_t>((nearestChannel(sums[j][0]/weight)<<10) | (nearestChannel(sums[j][1]/weight)<<5) | nearestChannel(sums[j][2]/weight))) ;
+    }
+    if (weights[31] <= 0.0){
+        rvalue[31] = rvalue[30] ;
+    }
+    // Stored as it would be in the mul (20 characters, sanitised)
+    rvalue.name() = name.substr(0,20) ;
+    return hueentry_t(rvalue.data()) ;
+}
+//=======================================================================================================================
+auto fitImages(const std::vector<std::filesystem::path> &paths) ->std::vector<std::pair<std::filesystem::path,hueentry_t>> {
+    auto images = std::vector<std::filesystem::path>() ;
+    for (const auto &path:paths){
+        if (std::filesystem::is_directory(path)){
+            auto found = std::vector<std::filesystem::path>() ;
+            for (const auto &entry:std::filesystem::directory_iterator(path)){
+                if (entry.is_regular_file() && (entry.path().extension() == ".ppm")){
+                    found.push_back(entry.path());
+                }
+            }
+            std::sort(found.begin(),found.end());
+            images.insert(images.end(),found.begin(),found.end());
+        }
+        else {
+            images.push_back(path);
+        }
+    }
+    auto rvalue = std::vector<std::pair<std::filesystem::path,hueentry_t>>(images.size()) ;
+    parallel::forEach(images.size(), [&images,&rvalue](std::size_t first,std::size_t last,std::size_t){
+        for (auto j = first ; j<last;j++){
+            rvalue[j] = std::make_pair(images[j],fitRamp(image_t(images[j]),images[j].stem().string(),false));
+        }
+    });
+    return rvalue ;
+}
+//=======================================================================================================================
+auto freeId(const huestorage_t &storage,std::uint32_t first) ->std::uint32_t {
+    auto id = std::max<std::uint32_t>(first,1) ;
+    while ((id < storage.size()) && !storage[id].empty()){
+        id++ ;
+    }
+    return static_cast<std::uint32_t>(std::min<size_t>(id,storage.size())) ;
+}
@@ -0,0 +1,29 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#ifndef huefit_hpp
+#define huefit_hpp
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include <filesystem>
+
+#include "huedata.hpp"
+#include "hueimage.hpp"
+
+//=======================================================================================================================
+// Fitting a hue ramp to an image.
+// The pixels are counted into an RGB555 histogram (split across the threads, each with its own
+// histogram), and the colors are sorted by luminance. The sorted distribution is cut into 32 equal
+// quantiles, darkest first, and each step of the ramp is the mean of its quantile in linear light.
+//=======================================================================================================================
+auto fitRamp(const image_t &image,const std::string &name,bool threaded=true) ->hueentry_t ;
+// Fits every image (a directory is expanded to the ppm files in it), an image per thread.
+// The entries are named by the image file name, in path order.
+auto fitImages(const std::vector<std::filesystem::path> &paths) ->std::vector<std::pair<std::filesystem::path,hueentry_t>> ;
+// The first blank id at or after first (id 0 is reserved, so first should be at least 1), or the
+// size of the storage if there is none (the id an append would use)
+auto freeId(const huestorage_t &storage,std::uint32_t first=1) ->std::uint32_t ;
+
+#endif /* huefit_hpp */
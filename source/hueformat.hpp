@@ -0,0 +1,63 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#ifndef hueformat_hpp
+#define hueformat_hpp
+
+#include <cstdint>
+#include <cstddef>
+
+//=======================================================================================================================
+// hueformat_t  The layout of a hue mul, fixed at compile time.
+// The stock client reads groups of 8 entries, each group led by a 4 byte header, and each entry
+// being 32 colors, TableStart, TableEnd, and a 20 character name. Modified clients that change any
+// of these get their own format, and the readers and writers are instantiated for it (by a
+// HUE_INSTANTIATE_FORMAT line in huedata.cpp), so the stock layout pays nothing for the others
+// (a group of 8 is still a mask, not a division).
+//=======================================================================================================================
+template <std::size_t EntriesPerGroup,std::size_t HeaderSize,std::size_t Colors,std::size_t NameLength>
+struct hueformat_t {
+    static_assert(EntriesPerGroup > 0, "A group needs at least one entry");
+    static_assert((Colors > 0) && (Colors <= 32), "An entry holds 1 to 32 colors");
+    static_assert(NameLength > 0, "An entry needs a name");
+    
+    static constexpr auto entriesPerGroup = EntriesPerGroup ;
+    static constexpr auto headerSize = HeaderSize ;
+    static constexpr auto colorCount = Colors ;
+    static constexpr auto nameLength = NameLength ;
+    
+    // HueEntry field offsets
+    static constexpr auto colorsOffset = std::size_t(0) ;
+    static constexpr auto tableStartOffset = colorsOffset + (Colors*2) ;
+    static constexpr auto tableEndOffset = tableStartOffset + 2 ;
+    static constexpr auto nameOffset = tableEndOffset + 2 ;
+    static constexpr auto entrySize = nameOffset + NameLength ;
+    static constexpr auto groupSize = HeaderSize + (EntriesPerGroup*entrySize) ;
+    
+    //=================================================================================
+    // True if the id is the first of its group (so a header precedes it)
+    static constexpr auto startsGroup(std::uint64_t id) ->bool {
+        return (id%EntriesPerGroup) == 0 ;
+    }
+    //=================================================================================
+    // Offset of an entry in the mul
+    static constexpr auto entryOffset(std::uint64_t id) ->std::uint64_t {
+        return ((id/EntriesPerGroup)*groupSize) + HeaderSize + ((id%EntriesPerGroup)*entrySize) ;
+    }
+    //=================================================================================
+    // The number of entries a mul of the given size holds
+    static constexpr auto entryCount(std::uint64_t filesize) ->std::uint64_t {
+        auto remainder = filesize%groupSize ;
+        return ((filesize/groupSize)*EntriesPerGroup) + (remainder > HeaderSize ? (remainder-HeaderSize)/entrySize : 0) ;
+    }
+    //=================================================================================
+    // A count of entries rounded up to whole groups
+    static constexpr auto roundUp(std::uint64_t count) ->std::uint64_t {
+        return ((count + EntriesPerGroup - 1)/EntriesPerGroup)*EntriesPerGroup ;
+    }
+};
+
+using stock_format = hueformat_t<8,4,32,20> ;
+static_assert(stock_format::entrySize == 88);
+static_assert(stock_format::groupSize == 708);
+
+#endif /* hueformat_hpp */
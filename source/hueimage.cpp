@@ -0,0 +1,199 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#include "hueimage.hpp"
+
+#include <array>
+#include <cctype>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "huecodec.hpp"
+
+using namespace std::string_literals;
+
+//=======================================================================================================================
+// Adler-32 of the zlib stream, reduced every 5552 bytes (the most that can not overflow)
+inline auto adler32(std::uint32_t adler,const std::uint8_t *data,std::size_t length) ->std::uint32_t {
+    auto a = adler & 0xffff ;
+    auto b = adler >> 16 ;
+    while (length > 0){
+        auto amount = std::min<std::size_t>(length,5552) ;
+        for (std::size_t j = 0 ; j<amount;j++){
+            a += data[j] ;
+            b += a ;
+        }
+        a %= 65521 ;
+        b %= 65521 ;
+        data += amount ;
+        length -= amount ;
+    }
+    return (b<<16) | a ;
+}
+//=======================================================================================================================
+// Big endian, as png wants
+inline auto storeBig(std::uint8_t *data,std::uint32_t value) ->void {
+    huecodec::store(data,huecodec::little ? huecodec::byteswap(value) : value);
+}
+
+//=======================================================================================================================
+// imagewriter_t
+//=======================================================================================================================
+
+//=======================================================================================================================
+imagewriter_t::imagewriter_t(const std::filesystem::path &path,std::uint32_t imagewidth,std::uint32_t imageheight):imagepath(path),width(imagewidth),height(imageheight),written(0),adler(1){
+    if ((width == 0) || (height == 0)){
+        throw std::runtime_error("Image has no size: "s + path.string());
+    }
+    png = path.extension() == ".png" ;
+    output.open(path.string(),std::ios::binary);
+    if (!output.is_open()){
+        throw std::runtime_error("Unable to create: "s + path.string());
+    }
+    if (!png){
+        output << "P6\n"<<width<<" "<<height<<"\n255\n" ;
+        return ;
+    }
+    const std::uint8_t signature[] = {0x89,'P','N','G','\r','\n',0x1a,'\n'} ;
+    output.write(reinterpret_cast<const char*>(signature),sizeof(signature));
+    auto header = std::array<std::uint8_t,13>{} ;
+    storeBig(header.data(),width);
+    storeBig(header.data()+4,height);
+    header[8] = 8 ;    // bit depth
+    header[9] = 2 ;    // truecolor
+    chunk("IHDR",header.data(),header.size());
+}
+//=======================================================================================================================
+auto imagewriter_t::chunk(const char *type,const std::uint8_t *data,std::size_t length) ->void {
+    auto bytes = std::array<std::uint8_t,8>{} ;
+    storeBig(bytes.data(),static_cast<std::uint32_t>(length));
+    std::copy(type,type+4,bytes.begin()+4);
+    output.write(reinterpret_cast<const char*>(bytes.data()),bytes.size());
+    output.write(reinterpret_cast<const char*>(data),static_cast<std::streamsize>(length));
+    auto crc = huecodec::crc32(huecodec::crc32(0xFFFFFFFFu,bytes.data()+4,4),data,length) ^ 0xFFFFFFFFu ;
+    storeBig(bytes.data(),crc);
+    output.write(reinterpret_cast<const char*>(bytes.data()),4);
+}
+//=======================================================================================================================
+// Each band becomes one IDAT chunk. The chunks together are a single zlib stream: the zlib header
+// leads the first, each scanline (filter byte 0, then the pixels) is a stored block, and the last
+// block is marked final and followed by the adler-32.
+auto imagewriter_t::write(const std::uint8_t *rows,std::uint32_t count) ->void {
+    if (written + count > height){
+        throw std::runtime_error("Too many rows written to: "s + imagepath.string());
+    }
+    auto stride = std::size_t(width)*3 ;
+    if (!png){
+        output.write(reinterpret_cast<const char*>(rows),static_cast<std::streamsize>(stride*count));
+        written += count ;
+        return ;
+    }
+    if (stride + 1 > 0xFFFF){
+        throw std::runtime_error("Image is too wide for stored png rows: "s + imagepath.string());
+    }
+    auto data = std::vector<std::uint8_t>() ;
+    data.reserve((stride+6)*count + 6);
+    if (written == 0){
+        data.push_back(0x78);
+        data.push_back(0x01);
+    }
+    for (std::uint32_t row = 0 ; row<count;row++){
+        auto length = static_cast<std::uint16_t>(stride+1) ;
+        auto last = (written + row + 1) == height ;
+        data.push_back(last ? 1 : 0);
+        data.push_back(static_cast<std::uint8_t>(length & 0xff));
+        data.push_back(static_cast<std::uint8_t>(length >> 8));
+        data.push_back(static_cast<std::uint8_t>(~length & 0xff));
+        data.push_back(static_cast<std::uint8_t>((~length >> 8) & 0xff));
+        auto start = data.size() ;
+        data.push_back(0);
+        data.insert(data.end(),rows+(row*stride),rows+((row+1)*stride));
+        adler = adler32(adler,data.data()+start,data.size()-start) ;
+    }
+    written += count ;
+    if (written == height){
+        auto trailer = std::array<std::uint8_t,4>{} ;
+        storeBig(trailer.data(),adler);
+        data.insert(data.end(),trailer.begin(),trailer.end());
+    }
+    chunk("IDAT",data.data(),data.size());
+}
+//=======================================================================================================================
+auto imagewriter_t::close() ->void {
+    if (written != height){
+        throw std::runtime_error("Image is missing rows: "s + imagepath.string());
+    }
+    if (png){
+        chunk("IEND",nullptr,0);
+    }
+    output.close();
+    if (output.fail()){
+        throw std::runtime_error("Unable to write: "s + imagepath.string());
+    }
+}
+
+//=======================================================================================================================
+// image_t
+//=======================================================================================================================
+
+//=======================================================================================================================
+image_t::image_t(const std::filesystem::path &path):width(0),height(0){
+    auto input = std::ifstream(path.string(),std::ios::binary) ;
+    if (!input.is_open()){
+        throw std::runtime_error("Unable to open: "s + path.string());
+    }
+    // The header is whitespace separated, and # starts a comment to the end of the line
+    auto token = [&input,&path]() ->std::uint32_t {
+        auto value = std::string() ;
+        auto letter = input.get() ;
+        while (input.good() && (std::isspace(letter) || (letter == '#'))){
+            if (letter == '#'){
+                while (input.good() && (letter != '\n')){
+                    letter = input.get() ;
+                }
+            }
+            letter = input.get() ;
+        }
+        while (input.good() && std::isdigit(letter)){
+            value += static_cast<char>(letter) ;
+            letter = input.get() ;
+        }
+        if (value.empty() || (value.size() > 9)){
+            throw std::runtime_error("Invalid ppm: "s + path.string());
+        }
+        return static_cast<std::uint32_t>(std::stoul(value)) ;
+    };
+    auto magic = std::string(2,' ') ;
+    input.read(magic.data(),2);
+    if ((magic != "P6") && (magic != "P3")){
+        throw std::runtime_error("Not a ppm (P6 or P3): "s + path.string());
+    }
+    width = token() ;
+    height = token() ;
+    auto maximum = token() ;
+    if ((width == 0) || (height == 0) || (maximum == 0) || (maximum > 65535) || (std::uint64_t(width)*height > (std::uint64_t(1)<<28))){
+        throw std::runtime_error("Invalid ppm: "s + path.string());
+    }
+    auto count = std::size_t(width)*height*3 ;
+    pixels.resize(count);
+    auto scale = [maximum](std::uint32_t value) ->std::uint8_t {
+        return static_cast<std::uint8_t>(((std::min(value,maximum)*255) + (maximum/2))/maximum) ;
+    };
+    if (magic == "P3"){
+        for (auto &pixel:pixels){
+            pixel = scale(token()) ;
+        }
+        return ;
+    }
+    // A single whitespace character ends the binary header (token() consumed it)
+    auto samplesize = maximum > 255 ? std::size_t(2) : std::size_t(1) ;
+    auto data = std::vector<std::uint8_t>(count*samplesize) ;
+    input.read(reinterpret_cast<char*>(data.data()),static_cast<std::streamsize>(data.size()));
+    if (input.gcount() != static_cast<std::streamsize>(data.size())){
+        throw std::runtime_error("Truncated ppm: "s + path.string());
+    }
+    for (std::size_t j = 0 ; j<count;j++){
+        pixels[j] = scale(samplesize == 2 ? ((std::uint32_t(data[j*2])<<8) | data[(j*2)+1]) : data[j]) ;
+    }
+}
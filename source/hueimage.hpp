@@ -0,0 +1,44 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#ifndef hueimage_hpp
+#define hueimage_hpp
+
+#include <cstdint>
+#include <cstddef>
+#include <fstream>
+#include <vector>
+#include <filesystem>
+
+//=======================================================================================================================
+// imagewriter_t  Writes an 8 bit RGB image a band of rows at a time, so the whole image is never
+// held in memory. A path ending in .png is written as a png, with the image data in stored
+// (uncompressed) deflate blocks, anything else as a binary ppm (P6).
+//=======================================================================================================================
+class imagewriter_t {
+    std::ofstream output ;
+    std::filesystem::path imagepath ;
+    std::uint32_t width ;
+    std::uint32_t height ;
+    std::uint32_t written ;
+    bool png ;
+    std::uint32_t adler ;
+
+    auto chunk(const char *type,const std::uint8_t *data,std::size_t length) ->void ;
+public:
+    imagewriter_t(const std::filesystem::path &path,std::uint32_t imagewidth,std::uint32_t imageheight) ;
+    // rows holds count rows of width*3 bytes
+    auto write(const std::uint8_t *rows,std::uint32_t count) ->void ;
+    auto close() ->void ;
+};
+
+//=======================================================================================================================
+// An 8 bit RGB image, read from a ppm (binary P6 or text P3, with any maximum value)
+//=======================================================================================================================
+struct image_t {
+    std::uint32_t width ;
+    std::uint32_t height ;
+    std::vector<std::uint8_t> pixels ;
+    image_t(const std::filesystem::path &path) ;
+};
+
+#endif /* hueimage_hpp */
@@ -0,0 +1,335 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#include "huejournal.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <system_error>
+
+#if defined(_WIN32)
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "huecodec.hpp"
+#include "strutil.hpp"
+
+using namespace std::string_literals;
+
+//=======================================================================================================================
+constexpr auto journalHeader = std::array<std::uint8_t,8>{'H','U','E','J',1,0,0,0} ;
+constexpr auto recordOverhead = size_t(1 + 4 + 1 + 4) ;
+
+//=======================================================================================================================
+// Appends the bytes to the file, and waits for them to reach the disk
+auto appendDurable(const std::filesystem::path &path,const std::vector<std::uint8_t> &bytes) ->void {
+#if defined(_WIN32)
+    auto fd = _open(path.string().c_str(),_O_WRONLY|_O_APPEND|_O_CREAT|_O_BINARY,_S_IREAD|_S_IWRITE) ;
+    if (fd < 0){
+        throw std::runtime_error("Unable to open: "s + path.string());
+    }
+    auto ok = _write(fd,bytes.data(),static_cast<unsigned int>(bytes.size())) == static_cast<int>(bytes.size()) ;
+    ok = ok && (_commit(fd) == 0) ;
+    _close(fd);
+    if (!ok){
+        throw std::runtime_error("Unable to write: "s + path.string());
+    }
+#else
+    auto fd = ::open(path.string().c_str(),O_WRONLY|O_APPEND|O_CREAT,0644) ;
+    if (fd < 0){
+        throw std::runtime_error("Unable to open: "s + path.string());
+    }
+    auto data = bytes.data() ;
+    auto remaining = bytes.size() ;
+    while (remaining > 0){
+        auto amount = ::write(fd,data,remaining) ;
+        if (amount < 0){
+            if (errno == EINTR){
+                continue;
+            }
+            ::close(fd);
+            throw std::runtime_error("Unable to write: "s + path.string());
+        }
+        data += amount ;
+        remaining -= static_cast<size_t>(amount) ;
+    }
+    auto synced = ::fsync(fd) == 0 ;
+    ::close(fd);
+    if (!synced){
+        throw std::runtime_error("Unable to sync: "s + path.string());
+    }
+#endif
+}
+//=======================================================================================================================
+// Flushes the entries of a directory (a rename or removal in it) to disk. Windows has no equivalent
+auto syncDirectory(const std::filesystem::path &path) ->void {
+#if !defined(_WIN32)
+    auto directory = path.parent_path() ;
+    if (directory.empty()){
+        directory = "." ;
+    }
+    auto fd = ::open(directory.string().c_str(),O_RDONLY|O_DIRECTORY) ;
+    if (fd < 0){
+        throw std::runtime_error("Unable to open: "s + directory.string());
+    }
+    auto synced = ::fsync(fd) == 0 ;
+    ::close(fd);
+    if (!synced){
+        throw std::runtime_error("Unable to sync: "s + directory.string());
+    }
+#else
+    (void)path ;
+#endif
+}
+
+//=======================================================================================================================
+// The valid records of a journal, and the number of bytes they span (from the start of the file)
+struct journalrecord_t {
+    huejournal_t::op_t op ;
+    std::uint32_t id ;
+    std::vector<std::uint8_t> payload ;
+};
+auto readJournal(const std::filesystem::path &path,std::vector<journalrecord_t> &records) ->size_t {
+    auto input = std::ifstream(path.string(),std::ios::binary) ;
+    if (!input.is_open()){
+        throw std::runtime_error("Unable to open: "s + path.string());
+    }
+    auto data = std::vector<std::uint8_t>(std::istreambuf_iterator<char>(input),std::istreambuf_iterator<char>()) ;
+    if (data.size() < journalHeader.size()){
+        return 0 ;
+    }
+    if (!std::equal(journalHeader.begin(),journalHeader.end(),data.begin())){
+        throw std::runtime_error("Not a hue journal: "s + path.string());
+    }
+    auto offset = journalHeader.size() ;
+    while (data.size() - offset >= recordOverhead){
+        auto length = size_t(data[offset+5]) ;
+        if (data.size() - offset < recordOverhead + length){
+            break;
+        }
+        auto crc = huecodec::crc32(0xFFFFFFFFu,data.data()+offset,6+length) ^ 0xFFFFFFFFu ;
+        if (crc != huecodec::load<std::uint32_t>(data.data()+offset+6+length)){
+            break;
+        }
+        auto op = static_cast<huejournal_t::op_t>(data[offset]) ;
+        auto id = huecodec::load<std::uint32_t>(data.data()+offset+1) ;
+        records.push_back(journalrecord_t{op,id,std::vector<std::uint8_t>(data.begin()+static_cast<std::ptrdiff_t>(offset+6),data.begin()+static_cast<std::ptrdiff_t>(offset+6+length))});
+        offset += recordOverhead + length ;
+    }
+    return offset ;
+}
+
+//=======================================================================================================================
+// huejournal_t
+//=======================================================================================================================
+
+//=======================================================================================================================
+auto huejournal_t::path(const std::filesystem::path &huepath) ->std::filesystem::path {
+    auto rvalue = huepath ;
+    rvalue += ".journal" ;
+    return rvalue ;
+}
+//=======================================================================================================================
+auto huejournal_t::replay(const std::filesystem::path &huepath,huestorage_t &storage) ->size_t {
+    auto journal = path(huepath) ;
+    if (!std::filesystem::exists(journal)){
+        return 0 ;
+    }
+    auto records = std::vector<journalrecord_t>() ;
+    readJournal(journal,records);
+    for (const auto &record:records){
+        // Grow the table (with blank entries) to reach the id
+        while (record.id >= storage.size()){
+            storage.append(hueentry_t());
+        }
+        switch (record.op){
+            case op_t::set:
+            case op_t::append:
+                storage[record.id] = hueentry_t(record.payload) ;
+                break;
+            case op_t::clear:
+                storage[record.id] = hueentry_t() ;
+                break;
+            case op_t::rename:
+                storage[record.id].name() = std::string(record.payload.begin(),record.payload.end()) ;
+                break;
+            default:
+                throw std::runtime_error("Unknown hue journal edit in: "s + journal.string());
+        }
+    }
+    return records.size() ;
+}
+//=======================================================================================================================
+// The new table is written beside the old and renamed over it, and only then is the journal removed.
+// A crash at any point leaves either the old table and its journal, or the new table (and perhaps
+// the journal, which replays to the same result).
+auto huejournal_t::checkpoint(const std::filesystem::path &huepath,std::uint32_t maxnum) ->size_t {
+    auto journal = path(huepath) ;
+    if (!std::filesystem::exists(journal)){
+        return 0 ;
+    }
+    auto hues = huestorage_t(maxnum) ;
+    if (std::filesystem::exists(huepath)){
+        // load replays the journal
+        hues.load(huepath);
+    }
+    else {
+        replay(huepath,hues);
+    }
+    auto records = std::vector<journalrecord_t>() ;
+    readJournal(journal,records);
+    if (!hues.empty()){
+        // The temporary keeps the extension, so an archive is written as an archive (a.tmp.huez)
+        auto temppath = huepath ;
+        temppath.replace_filename(huepath.stem().string() + ".tmp"s + huepath.extension().string());
+        hues.save(temppath);
+        // Appending nothing just flushes the new table to disk, before it replaces the old one
+        appendDurable(temppath,std::vector<std::uint8_t>());
+        std::filesystem::rename(temppath, huepath);
+        syncDirectory(huepath);
+    }
+    std::filesystem::remove(journal);
+    syncDirectory(journal);
+    return records.size() ;
+}
+//=======================================================================================================================
+auto huejournal_t::discard(const std::filesystem::path &huepath) ->void {
+    if (isStdio(huepath)){
+        return ;
+    }
+    auto journal = path(huepath) ;
+    if (std::filesystem::exists(journal)){
+        std::filesystem::remove(journal);
+    }
+}
+//=======================================================================================================================
+// A torn record left at the end by a crash is cut off, so new records follow the last good one
+huejournal_t::huejournal_t(const std::filesystem::path &huemul,std::uint32_t maxnum,size_t editsPerCommit):huepath(huemul),journalpath(path(huemul)),hues(maxnum),pendingcount(0),groupsize(std::max<size_t>(1,editsPerCommit)){
+    if (std::filesystem::exists(huepath)){
+        hues.load(huepath);
+    }
+    else {
+        replay(huepath,hues);
+    }
+    if (std::filesystem::exists(journalpath)){
+        auto records = std::vector<journalrecord_t>() ;
+        auto valid = readJournal(journalpath,records) ;
+        if (valid < std::filesystem::file_size(journalpath)){
+            std::filesystem::resize_file(journalpath,std::max(valid,journalHeader.size()));
+        }
+        if (valid < journalHeader.size()){
+            std::filesystem::remove(journalpath);
+        }
+    }
+    if (!std::filesystem::exists(journalpath)){
+        appendDurable(journalpath,std::vector<std::uint8_t>(journalHeader.begin(),journalHeader.end()));
+    }
+}
+//=======================================================================================================================
+huejournal_t::~huejournal_t() {
+    try {
+        commit();
+    }
+    catch (const std::exception &e){
+        std::cerr <<e.what()<<std::endl;
+    }
+}
+//=======================================================================================================================
+auto huejournal_t::record(op_t op,std::uint32_t id,const std::uint8_t *payload,std::uint8_t length) ->void {
+    auto start = pending.size() ;
+    pending.resize(start + recordOverhead + length);
+    auto data = pending.data() + start ;
+    data[0] = static_cast<std::uint8_t>(op) ;
+    huecodec::store(data+1,id);
+    data[5] = length ;
+    std::copy(payload,payload+length,data+6);
+    huecodec::store(data+6+length,huecodec::crc32(0xFFFFFFFFu,data,6+length) ^ 0xFFFFFFFFu);
+    if (++pendingcount >= groupsize){
+        commit();
+    }
+}
+//=======================================================================================================================
+auto huejournal_t::set(std::uint32_t id,const hueentry_t &entry) ->void {
+    if (id >= hues.size()){
+        throw std::out_of_range("Hue id exceeds the number of hues: "s + std::to_string(id));
+    }
+    hues[id] = entry ;
+    auto data = entry.data() ;
+    record(op_t::set,id,data.data(),static_cast<std::uint8_t>(data.size()));
+}
+//=======================================================================================================================
+auto huejournal_t::clear(std::uint32_t id) ->void {
+    if (id >= hues.size()){
+        throw std::out_of_range("Hue id exceeds the number of hues: "s + std::to_string(id));
+    }
+    hues[id] = hueentry_t() ;
+    record(op_t::clear,id,nullptr,0);
+}
+//=======================================================================================================================
+// The name is stored as it would be in the mul (20 characters at most)
+auto huejournal_t::rename(std::uint32_t id,const std::string &name) ->void {
+    if (id >= hues.size()){
+        throw std::out_of_range("Hue id exceeds the number of hues: "s + std::to_string(id));
+    }
+    auto &entry = hues[id] ;
+    entry.name() = name.substr(0,20) ;
+    auto data = entry.data() ;
+    entry = hueentry_t(data) ;
+    record(op_t::rename,id,reinterpret_cast<const std::uint8_t*>(entry.name().data()),static_cast<std::uint8_t>(entry.name().size()));
+}
+//=======================================================================================================================
+auto huejournal_t::append(const hueentry_t &entry) ->std::uint32_t {
+    auto id = hues.append(entry) ;
+    auto data = entry.data() ;
+    record(op_t::append,id,data.data(),static_cast<std::uint8_t>(data.size()));
+    return id ;
+}
+//=======================================================================================================================
+auto huejournal_t::edit(std::string_view line) ->void {
+    auto [op,rest] = strutil::split_view(line,",") ;
+    auto lowered = strutil::lower(std::string(strutil::trim_view(op))) ;
+    if (lowered == "append"){
+        auto id = append(hueentry_t(rest)) ;
+        std::clog <<"Appended id "<<id<<std::endl;
+        return ;
+    }
+    auto [idtext,value] = strutil::split_view(rest,",") ;
+    auto id = std::uint32_t(0) ;
+    if (strutil::ston(idtext,id) != std::errc()){
+        throw std::runtime_error("Invalid hue id in edit: "s + std::string(line));
+    }
+    if (lowered == "set"){
+        set(id,hueentry_t(value));
+    }
+    else if (lowered == "clear"){
+        clear(id);
+    }
+    else if (lowered == "rename"){
+        rename(id,std::string(value));
+    }
+    else {
+        throw std::runtime_error("Unknown edit: "s + std::string(line));
+    }
+}
+//=======================================================================================================================
+auto huejournal_t::commit() ->void {
+    if (pending.empty()){
+        return ;
+    }
+    appendDurable(journalpath,pending);
+    pending.clear();
+    pendingcount = 0 ;
+}
+//=======================================================================================================================
+auto huejournal_t::storage() const ->const huestorage_t& {
+    return hues ;
+}
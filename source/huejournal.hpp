@@ -0,0 +1,66 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#ifndef huejournal_hpp
+#define huejournal_hpp
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <filesystem>
+
+#include "huedata.hpp"
+
+//=======================================================================================================================
+// huejournal_t  Edits to a hue mul appended to a write ahead journal (the mul path + ".journal"),
+// instead of saving the whole table. Edits are buffered and written together, and the journal is
+// flushed to disk, on commit (every groupsize edits, and when the journal is closed).
+// Loading a hue mul replays its journal over it, and checkpoint folds the journal into the mul.
+// The journal is a "HUEJ" magic and a WORD version (1) and WORD reserved, then records of:
+//     BYTE op, DWORD id, BYTE length, BYTE payload[length], DWORD crc32 (of the bytes before it)
+// set and append carry the 88 byte entry, rename the name, clear nothing. Every record puts the id
+// in a final state (append is recorded with the id it was given), so replaying twice is harmless.
+// A record that is torn or fails its crc ends the journal, the edits after it are discarded.
+//=======================================================================================================================
+class huejournal_t {
+public:
+    enum class op_t : std::uint8_t {
+        set=1,clear=2,rename=3,append=4
+    };
+    static constexpr auto defaultGroupsize = size_t(64) ;
+private:
+    std::filesystem::path huepath ;
+    std::filesystem::path journalpath ;
+    huestorage_t hues ;
+    std::vector<std::uint8_t> pending ;
+    size_t pendingcount ;
+    size_t groupsize ;
+    
+    auto record(op_t op,std::uint32_t id,const std::uint8_t *payload,std::uint8_t length) ->void ;
+public:
+    static auto path(const std::filesystem::path &huepath) ->std::filesystem::path ;
+    // Replays the journal of huepath (if any) over storage. Returns the number of edits applied
+    static auto replay(const std::filesystem::path &huepath,huestorage_t &storage) ->size_t ;
+    // Folds the journal into the hue mul, and removes it
+    static auto checkpoint(const std::filesystem::path &huepath,std::uint32_t maxnum=3000) ->size_t ;
+    // Removes the journal of a hue mul that has just been rewritten as a whole (its edits are either
+    // in the new contents, or replaced by them)
+    static auto discard(const std::filesystem::path &huepath) ->void ;
+    
+    huejournal_t(const std::filesystem::path &huemul,std::uint32_t maxnum=3000,size_t editsPerCommit=defaultGroupsize) ;
+    ~huejournal_t() ;
+    huejournal_t(const huejournal_t&) = delete ;
+    auto operator=(const huejournal_t&) ->huejournal_t& = delete ;
+    
+    auto set(std::uint32_t id,const hueentry_t &entry) ->void ;
+    auto clear(std::uint32_t id) ->void ;
+    auto rename(std::uint32_t id,const std::string &name) ->void ;
+    auto append(const hueentry_t &entry) ->std::uint32_t ;
+    // One edit as text: set,id,name,r:g:b...  clear,id  rename,id,name  append,name,r:g:b...
+    auto edit(std::string_view line) ->void ;
+    auto commit() ->void ;
+    // The table with every edit so far applied
+    auto storage() const ->const huestorage_t& ;
+};
+
+#endif /* huejournal_hpp */
@@ -0,0 +1,155 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#include "huelayer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "huecodec.hpp"
+
+using namespace std::string_literals;
+
+//=======================================================================================================================
+// huepatch_t
+//=======================================================================================================================
+
+//=======================================================================================================================
+huepatch_t::huepatch_t(const std::filesystem::path &patchpath){
+    load(patchpath);
+}
+//=======================================================================================================================
+huepatch_t::huepatch_t(const huestorage_t &base,const huestorage_t &edited){
+    size = static_cast<std::uint32_t>(edited.size()) ;
+    for (const auto &id:base.changed(edited)){
+        if (id < size){
+            records.push_back(std::make_pair(id,edited[id]));
+        }
+    }
+}
+//=======================================================================================================================
+auto huepatch_t::load(const std::filesystem::path &patchpath) ->void {
+    auto input = std::ifstream(patchpath.string(),std::ios::binary) ;
+    if (!input.is_open()){
+        throw std::runtime_error("Unable to open: "s + patchpath.string());
+    }
+    auto header = std::array<std::uint8_t,12>() ;
+    input.read(reinterpret_cast<char*>(header.data()),header.size());
+    if ((input.gcount() != static_cast<std::streamsize>(header.size())) || !std::equal(header.begin(),header.begin()+4,"HUEP")){
+        throw std::runtime_error("Not a hue patch: "s + patchpath.string());
+    }
+    auto count = huecodec::load<std::uint32_t>(header.data()+4) ;
+    size = huecodec::load<std::uint32_t>(header.data()+8) ;
+    records.clear();
+    records.reserve(count);
+    auto buffer = std::vector<std::uint8_t>(4+hueentry_size) ;
+    for (std::uint32_t j = 0 ; j<count;j++){
+        input.read(reinterpret_cast<char*>(buffer.data()),buffer.size());
+        if (input.gcount() != static_cast<std::streamsize>(buffer.size())){
+            throw std::runtime_error("Truncated hue patch: "s + patchpath.string());
+        }
+        auto id = huecodec::load<std::uint32_t>(buffer.data()) ;
+        if (!records.empty() && (records.back().first >= id)){
+            throw std::runtime_error("Hue patch ids out of order at: "s + std::to_string(id));
+        }
+        if (id >= size){
+            throw std::runtime_error("Hue patch id exceeds its size at: "s + std::to_string(id));
+        }
+        records.push_back(std::make_pair(id,hueentry_t(std::vector<std::uint8_t>(buffer.begin()+4,buffer.end()))));
+    }
+}
+//=======================================================================================================================
+auto huepatch_t::save(const std::filesystem::path &patchpath) const ->void {
+    auto output = std::ofstream(patchpath.string(),std::ios::binary) ;
+    if (!output.is_open()){
+        throw std::runtime_error("Unable to create: "s + patchpath.string());
+    }
+    auto header = std::array<std::uint8_t,12>{'H','U','E','P'} ;
+    huecodec::store<std::uint32_t>(header.data()+4,static_cast<std::uint32_t>(records.size()));
+    huecodec::store<std::uint32_t>(header.data()+8,size);
+    output.write(reinterpret_cast<const char*>(header.data()),header.size());
+    for (const auto &[id,entry]:records){
+        auto buffer = std::array<std::uint8_t,4>() ;
+        huecodec::store<std::uint32_t>(buffer.data(),id);
+        output.write(reinterpret_cast<const char*>(buffer.data()),buffer.size());
+        auto data = entry.data() ;
+        output.write(reinterpret_cast<const char*>(data.data()),data.size());
+    }
+}
+//=======================================================================================================================
+auto huepatch_t::find(std::uint32_t id) const ->const hueentry_t* {
+    auto iter = std::lower_bound(records.begin(),records.end(),id,[](const std::pair<std::uint32_t,hueentry_t> &record,std::uint32_t value){
+        return record.first < value ;
+    });
+    if ((iter == records.end()) || (iter->first != id)){
+        return nullptr ;
+    }
+    return &(iter->second) ;
+}
+
+//=======================================================================================================================
+// hueoverlay_t
+//=======================================================================================================================
+const hueentry_t hueoverlay_t::blankentry = hueentry_t() ;
+
+//=======================================================================================================================
+hueoverlay_t::hueoverlay_t(const std::filesystem::path &huepath,std::uint32_t maxnum):hueoverlay_t(huestorage_t(huepath,maxnum),maxnum){
+}
+//=======================================================================================================================
+hueoverlay_t::hueoverlay_t(huestorage_t storage,std::uint32_t maxnum):base(std::move(storage)),huemax(maxnum){
+    huecount = static_cast<std::uint32_t>(base.size()) ;
+    floor = huecount ;
+    patched.resize((static_cast<size_t>(huecount)+63)/64,0);
+}
+//=======================================================================================================================
+auto hueoverlay_t::push(huepatch_t patch) ->void {
+    if (patch.size > huemax){
+        throw std::runtime_error("Exceeds max number of hues of: "s + std::to_string(huemax));
+    }
+    if (!patch.records.empty() && (patch.records.back().first >= patch.size)){
+        throw std::runtime_error("Hue patch id exceeds its size at: "s + std::to_string(patch.records.back().first));
+    }
+    huecount = patch.size ;
+    floor = std::min(floor,patch.size) ;
+    patched.resize(std::max(patched.size(),(static_cast<size_t>(huecount)+63)/64),0);
+    for (const auto &record:patch.records){
+        patched[record.first>>6] |= std::uint64_t(1)<<(record.first&63) ;
+    }
+    layers.push_back(std::move(patch));
+}
+//=======================================================================================================================
+auto hueoverlay_t::push(const std::filesystem::path &patchpath) ->void {
+    push(huepatch_t(patchpath));
+}
+//=======================================================================================================================
+auto hueoverlay_t::size() const ->size_t {
+    return huecount ;
+}
+//=======================================================================================================================
+auto hueoverlay_t::operator[](std::uint32_t id) const ->const hueentry_t& {
+    if (id >= huecount){
+        throw std::out_of_range("Hue id exceeds the number of hues: "s + std::to_string(id));
+    }
+    if ((id >= floor) || ((patched[id>>6] & (std::uint64_t(1)<<(id&63))) != 0)){
+        for (auto iter = layers.rbegin() ; iter != layers.rend();iter++){
+            if (id >= iter->size){
+                return blankentry ;
+            }
+            auto entry = iter->find(id) ;
+            if (entry != nullptr){
+                return *entry ;
+            }
+        }
+    }
+    return id < base.size() ? base[id] : blankentry ;
+}
+//=======================================================================================================================
+auto hueoverlay_t::flatten() const ->huestorage_t {
+    auto rvalue = huestorage_t(huemax) ;
+    for (std::uint32_t id = 0 ; id<huecount;id++){
+        rvalue.append((*this)[id]);
+    }
+    return rvalue ;
+}
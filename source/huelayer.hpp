@@ -0,0 +1,60 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#ifndef huelayer_hpp
+#define huelayer_hpp
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <filesystem>
+
+#include "huedata.hpp"
+
+//=======================================================================================================================
+// huepatch_t  A sparse set of replacement entries (verdata style). On disk:
+//     char     magic[4]   "HUEP"
+//     DWORD    count
+//     DWORD    size       the number of entries in the patched table
+//     count records of    DWORD id, HueEntry entry (88 bytes)
+// All values are little endian, and the records are in id order. A blank entry clears the id.
+// The patched table is cut (or grown with blank entries) to size, so a patch can shrink a table.
+//=======================================================================================================================
+struct huepatch_t {
+    std::vector<std::pair<std::uint32_t,hueentry_t>> records ;
+    std::uint32_t size = 0 ;
+
+    huepatch_t() = default ;
+    huepatch_t(const std::filesystem::path &patchpath) ;
+    // The entries of edited that differ from base, and the size of edited
+    huepatch_t(const huestorage_t &base,const huestorage_t &edited) ;
+    auto load(const std::filesystem::path &patchpath) ->void ;
+    auto save(const std::filesystem::path &patchpath) const ->void ;
+    auto find(std::uint32_t id) const ->const hueentry_t* ;
+};
+
+//=======================================================================================================================
+// hueoverlay_t  A base table with patches stacked over it, resolved per id when read.
+// patched is a bitmap of the ids any patch touches, so an untouched id below floor (the smallest
+// size of any patch) goes straight to the base. Otherwise the patches are searched from the top of
+// the stack down, an id past the size of a patch being blank (that patch cut it off).
+// Nothing is combined until flatten is called.
+//=======================================================================================================================
+class hueoverlay_t {
+    huestorage_t base ;
+    std::vector<huepatch_t> layers ;
+    std::vector<std::uint64_t> patched ;
+    std::uint32_t huecount ;
+    std::uint32_t floor ;
+    std::uint32_t huemax ;
+    static const hueentry_t blankentry ;
+public:
+    hueoverlay_t(const std::filesystem::path &huepath,std::uint32_t maxnum=3000) ;
+    hueoverlay_t(huestorage_t storage,std::uint32_t maxnum=3000) ;
+    auto push(huepatch_t patch) ->void ;
+    auto push(const std::filesystem::path &patchpath) ->void ;
+    auto size() const ->size_t ;
+    auto operator[](std::uint32_t id) const ->const hueentry_t& ;
+    auto flatten() const ->huestorage_t ;
+};
+
+#endif /* huelayer_hpp */
@@ -0,0 +1,503 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#include "hueloader.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HUE_IO_URING 1
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+#endif
+
+#include "huearchive.hpp"
+#include "huejournal.hpp"
+#include "parallel.hpp"
+
+using namespace std::string_literals;
+
+namespace {
+    //=================================================================================
+    // A fixed set of threads running jobs in the order they are queued. finish() runs
+    // the jobs still queued, and waits for the threads.
+    class workpool_t {
+        std::mutex lock ;
+        std::condition_variable ready ;
+        std::deque<std::function<void()>> jobs ;
+        bool closing = false ;
+        std::vector<std::thread> workers ;
+    public:
+        workpool_t(size_t count){
+            for (size_t j = 0 ; j<count;j++){
+                workers.emplace_back([this](){
+                    while (true){
+                        auto job = std::function<void()>() ;
+                        {
+                            auto guard = std::unique_lock<std::mutex>(lock) ;
+                            ready.wait(guard,[this](){return closing || !jobs.empty();});
+                            if (jobs.empty()){
+                                return ;
+                            }
+                            job = std::move(jobs.front()) ;
+                            jobs.pop_front() ;
+                        }
+                        job();
+                    }
+                });
+            }
+        }
+        ~workpool_t(){
+            finish();
+        }
+        auto push(std::function<void()> &&job) ->void {
+            {
+                auto guard = std::lock_guard<std::mutex>(lock) ;
+                jobs.push_back(std::move(job));
+            }
+            ready.notify_one();
+        }
+        auto finish() ->void {
+            {
+                auto guard = std::lock_guard<std::mutex>(lock) ;
+                closing = true ;
+            }
+            ready.notify_all();
+            for (auto &worker:workers){
+                if (worker.joinable()){
+                    worker.join();
+                }
+            }
+        }
+    };
+
+#if defined(HUE_IO_URING)
+    //=================================================================================
+    // The submission and completion rings of an io_uring, set up with the raw system calls
+    // (so there is no dependency on liburing). Each read carries the slot it was made for.
+    class ring_t {
+        int fd = -1 ;
+        void *sqmap = MAP_FAILED ;
+        size_t sqlength = 0 ;
+        void *cqmap = MAP_FAILED ;
+        size_t cqlength = 0 ;
+        io_uring_sqe *sqes = static_cast<io_uring_sqe*>(MAP_FAILED) ;
+        size_t sqeslength = 0 ;
+        unsigned *sqhead = nullptr ;
+        unsigned *sqtail = nullptr ;
+        unsigned *sqmask = nullptr ;
+        unsigned *sqarray = nullptr ;
+        unsigned *cqhead = nullptr ;
+        unsigned *cqtail = nullptr ;
+        unsigned *cqmask = nullptr ;
+        io_uring_cqe *cqes = nullptr ;
+        unsigned entries = 0 ;
+        unsigned queued = 0 ;
+
+        template <typename T>
+        static auto at(void *base,unsigned offset) ->T* {
+            return reinterpret_cast<T*>(static_cast<char*>(base)+offset) ;
+        }
+    public:
+        //=================================================================================
+        ring_t(unsigned depth){
+            auto params = io_uring_params{} ;
+            fd = static_cast<int>(::syscall(__NR_io_uring_setup,depth,&params)) ;
+            if (fd < 0){
+                return ;
+            }
+            entries = params.sq_entries ;
+            sqlength = params.sq_off.array + (params.sq_entries*sizeof(unsigned)) ;
+            cqlength = params.cq_off.cqes + (params.cq_entries*sizeof(io_uring_cqe)) ;
+            if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0){
+                sqlength = std::max(sqlength,cqlength) ;
+            }
+            sqmap = ::mmap(nullptr,sqlength,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,fd,IORING_OFF_SQ_RING) ;
+            if (sqmap == MAP_FAILED){
+                return ;
+            }
+            if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0){
+                cqmap = sqmap ;
+            }
+            else {
+                cqmap = ::mmap(nullptr,cqlength,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,fd,IORING_OFF_CQ_RING) ;
+                if (cqmap == MAP_FAILED){
+                    return ;
+                }
+            }
+            sqeslength = params.sq_entries*sizeof(io_uring_sqe) ;
+            sqes = static_cast<io_uring_sqe*>(::mmap(nullptr,sqeslength,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,fd,IORING_OFF_SQES)) ;
+            if (sqes == MAP_FAILED){
+                return ;
+            }
+            sqhead = at<unsigned>(sqmap,params.sq_off.head) ;
+            sqtail = at<unsigned>(sqmap,params.sq_off.tail) ;
+            sqmask = at<unsigned>(sqmap,params.sq_off.ring_mask) ;
+            sqarray = at<unsigned>(sqmap,params.sq_off.array) ;
+            cqhead = at<unsigned>(cqmap,params.cq_off.head) ;
+            cqtail = at<unsigned>(cqmap,params.cq_off.tail) ;
+            cqmask = at<unsigned>(cqmap,params.cq_off.ring_mask) ;
+            cqes = at<io_uring_cqe>(cqmap,params.cq_off.cqes) ;
+        }
+        //=================================================================================
+        // Closing the ring cancels what is still in flight, but does not wait for it (see drain)
+        ~ring_t(){
+            if (sqes != MAP_FAILED){
+                ::munmap(sqes,sqeslength);
+            }
+            if ((cqmap != MAP_FAILED) && (cqmap != sqmap)){
+                ::munmap(cqmap,cqlength);
+            }
+            if (sqmap != MAP_FAILED){
+                ::munmap(sqmap,sqlength);
+            }
+            if (fd >= 0){
+                ::close(fd);
+            }
+        }
+        ring_t(const ring_t&) = delete ;
+        auto operator=(const ring_t&) ->ring_t& = delete ;
+        //=================================================================================
+        auto ready() const ->bool {
+            return (fd >= 0) && (sqes != MAP_FAILED) ;
+        }
+        //=================================================================================
+        auto depth() const ->unsigned {
+            return entries ;
+        }
+        //=================================================================================
+        // The caller keeps no more than depth() reads outstanding, so there is always room
+        auto read(int file,std::uint8_t *buffer,unsigned length,std::uint64_t offset,std::uint64_t slot) ->void {
+            auto tail = *sqtail ;
+            auto index = tail & *sqmask ;
+            auto &sqe = sqes[index] ;
+            sqe = io_uring_sqe{} ;
+            sqe.opcode = IORING_OP_READ ;
+            sqe.fd = file ;
+            sqe.addr = reinterpret_cast<std::uint64_t>(buffer) ;
+            sqe.len = length ;
+            sqe.off = offset ;
+            sqe.user_data = slot ;
+            sqarray[index] = index ;
+            __atomic_store_n(sqtail,tail+1,__ATOMIC_RELEASE);
+            queued++ ;
+        }
+        //=================================================================================
+        // Submits the queued reads, and waits for at least one to complete. False if the ring failed
+        auto submit() ->bool {
+            while (true){
+                auto result = ::syscall(__NR_io_uring_enter,fd,queued,1,IORING_ENTER_GETEVENTS,nullptr,0) ;
+                if (result >= 0){
+                    queued -= std::min(queued,static_cast<unsigned>(result)) ;
+                    return true ;
+                }
+                if ((errno != EINTR) && (errno != EAGAIN) && (errno != EBUSY)){
+                    return false ;
+                }
+            }
+        }
+        //=================================================================================
+        // Waits for a completion without submitting anything. If even that fails, it just sleeps
+        // a little (the kernel still posts completions to the ring)
+        auto wait() ->void {
+            if (::syscall(__NR_io_uring_enter,fd,0,1,IORING_ENTER_GETEVENTS,nullptr,0) < 0){
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        //=================================================================================
+        // The slots of the reads queued that the kernel has not taken
+        auto unsubmitted() const ->std::vector<std::uint64_t> {
+            auto rvalue = std::vector<std::uint64_t>() ;
+            auto tail = *sqtail ;
+            for (auto head = __atomic_load_n(sqhead,__ATOMIC_ACQUIRE) ; head != tail ; head++){
+                rvalue.push_back(sqes[sqarray[head & *sqmask]].user_data);
+            }
+            return rvalue ;
+        }
+        //=================================================================================
+        // Hands each completion (slot, result) to handler. Returns the number of completions
+        auto reap(const std::function<void(std::uint64_t,int)> &handler) ->size_t {
+            auto count = size_t(0) ;
+            auto head = *cqhead ;
+            auto tail = __atomic_load_n(cqtail,__ATOMIC_ACQUIRE) ;
+            while (head != tail){
+                const auto &cqe = cqes[head & *cqmask] ;
+                auto slot = cqe.user_data ;
+                auto result = cqe.res ;
+                head++ ;
+                count++ ;
+                __atomic_store_n(cqhead,head,__ATOMIC_RELEASE);
+                handler(slot,result);
+            }
+            return count ;
+        }
+    };
+#endif
+}
+
+//=======================================================================================================================
+// hueloader_t
+//=======================================================================================================================
+
+//=======================================================================================================================
+hueloader_t::hueloader_t(const std::vector<std::filesystem::path> &huepaths,std::uint32_t maxnum):paths(huepaths),huemax(maxnum),promises(huepaths.size()),settled(huepaths.size()){
+    for (auto &promise:promises){
+        futures.push_back(promise.get_future());
+    }
+    driver = std::thread([this](){
+        run();
+    });
+}
+//=======================================================================================================================
+hueloader_t::~hueloader_t(){
+    if (driver.joinable()){
+        driver.join();
+    }
+}
+//=======================================================================================================================
+auto hueloader_t::size() const ->size_t {
+    return paths.size() ;
+}
+//=======================================================================================================================
+auto hueloader_t::operator[](size_t index) ->std::future<huestorage_t>& {
+    return futures.at(index) ;
+}
+//=======================================================================================================================
+// Each promise is settled once, whichever of the pool or an error gets to it first
+auto hueloader_t::fulfil(size_t index,huestorage_t &&storage) ->void {
+    if (!settled[index].exchange(true)){
+        promises[index].set_value(std::move(storage));
+    }
+}
+//=======================================================================================================================
+auto hueloader_t::fail(size_t index,std::exception_ptr error) ->void {
+    if (!settled[index].exchange(true)){
+        promises[index].set_exception(error);
+    }
+}
+//=======================================================================================================================
+// Anything thrown on the loading thread fails the futures not yet settled, rather than terminating
+auto hueloader_t::run() ->void {
+    try {
+        dispatch();
+    }
+    catch (...){
+        auto error = std::current_exception() ;
+        for (size_t index = 0 ; index<paths.size();index++){
+            fail(index,error);
+        }
+    }
+}
+//=======================================================================================================================
+// A mul whose read fails in any way is handed to the pool to load by path, which either succeeds
+// or reports why.
+auto hueloader_t::dispatch() ->void {
+    auto pool = workpool_t(parallel::threads(paths.size())) ;
+    auto loadPath = [this,&pool](size_t index){
+        pool.push([this,index](){
+            try {
+                fulfil(index,huestorage_t(paths[index],huemax));
+            }
+            catch (...){
+                fail(index,std::current_exception());
+            }
+        });
+    };
+#if defined(HUE_IO_URING)
+    auto decodeBytes = [this,&pool](size_t index,std::vector<std::uint8_t> &&bytes){
+        pool.push([this,index,bytes = std::move(bytes)](){
+            try {
+                auto storage = huestorage_t(huemax) ;
+                storage.load(bytes.data(),bytes.size());
+                huejournal_t::replay(paths[index],storage);
+                fulfil(index,std::move(storage));
+            }
+            catch (...){
+                fail(index,std::current_exception());
+            }
+        });
+    };
+    auto direct = std::vector<size_t>() ;
+    for (size_t index = 0 ; index<paths.size();index++){
+        if (isStdio(paths[index]) || isArchive(paths[index])){
+            loadPath(index);
+        }
+        else {
+            direct.push_back(index);
+        }
+    }
+    struct pending_t {
+        size_t index = 0 ;
+        int fd = -1 ;
+        std::vector<std::uint8_t> bytes ;
+        size_t offset = 0 ;
+        // A read of the buffer is queued or held by the kernel
+        bool reading = false ;
+    };
+    // A read is at most this long, a longer mul is read in pieces
+    constexpr auto piece = size_t(1)<<30 ;
+    auto slots = std::vector<pending_t>() ;
+    auto ring = std::make_unique<ring_t>(static_cast<unsigned>(std::min<size_t>(std::max<size_t>(direct.size(),1),64))) ;
+    if (!ring->ready()){
+        for (const auto &index:direct){
+            loadPath(index);
+        }
+        return ;
+    }
+    slots.resize(ring->depth());
+    auto available = std::vector<std::uint64_t>() ;
+    for (auto slot = slots.size() ; slot > 0 ; slot--){
+        available.push_back(slot-1);
+    }
+    auto readNext = [&ring,&slots,piece](std::uint64_t slot){
+        auto &pending = slots[slot] ;
+        auto length = std::min(pending.bytes.size()-pending.offset,piece) ;
+        ring->read(pending.fd,pending.bytes.data()+pending.offset,static_cast<unsigned>(length),pending.offset,slot);
+        pending.reading = true ;
+    };
+    // Closing the ring does not wait for the reads the kernel holds, so they are waited for before
+    // any buffer can be released (or the ring closed). Reads still queued were never taken.
+    auto drain = [&ring,&slots](){
+        if (!ring){
+            return ;
+        }
+        for (const auto &slot:ring->unsubmitted()){
+            slots[slot].reading = false ;
+        }
+        auto holding = [&slots](){
+            return std::any_of(slots.begin(),slots.end(),[](const pending_t &pending){return pending.reading;});
+        };
+        while (holding()){
+            if (ring->reap([&slots](std::uint64_t slot,int){slots[slot].reading = false;}) == 0){
+                ring->wait();
+            }
+        }
+        ring.reset();
+    };
+    // If anything throws, the ring is drained before the slots are destroyed
+    struct guard_t {
+        const std::function<void()> &action ;
+        ~guard_t(){
+            try {
+                action();
+            }
+            catch (...){
+            }
+        }
+    };
+    const auto drainAction = std::function<void()>(drain) ;
+    auto guard = guard_t{drainAction} ;
+    auto release = [&slots,&available](std::uint64_t slot){
+        auto &pending = slots[slot] ;
+        ::close(pending.fd);
+        pending = pending_t() ;
+        available.push_back(slot);
+    };
+    auto next = size_t(0) ;
+    auto inflight = size_t(0) ;
+    while ((next < direct.size()) || (inflight > 0)){
+        while ((next < direct.size()) && !available.empty()){
+            auto index = direct[next++] ;
+            auto fd = ::open(paths[index].c_str(),O_RDONLY|O_CLOEXEC) ;
+            if (fd < 0){
+                loadPath(index);
+                continue;
+            }
+            struct stat status ;
+            if ((::fstat(fd,&status) != 0) || !S_ISREG(status.st_mode)){
+                ::close(fd);
+                loadPath(index);
+                continue;
+            }
+            if (status.st_size == 0){
+                ::close(fd);
+                decodeBytes(index,std::vector<std::uint8_t>());
+                continue;
+            }
+            auto slot = available.back() ;
+            available.pop_back() ;
+            auto &pending = slots[slot] ;
+            pending.index = index ;
+            pending.fd = fd ;
+            try {
+                pending.bytes.resize(static_cast<size_t>(status.st_size));
+            }
+            catch (...){
+                // Such as a huge file that is not a mul
+                release(slot);
+                fail(index,std::current_exception());
+                continue;
+            }
+            pending.offset = 0 ;
+            readNext(slot);
+            inflight++ ;
+        }
+        if (inflight == 0){
+            continue;
+        }
+        if (!ring->submit()){
+            // The files and buffers are only released once the kernel is done with them, and the
+            // pool loads whatever was not read
+            drain();
+            for (auto slot = std::uint64_t(0) ; slot<slots.size();slot++){
+                if (slots[slot].fd >= 0){
+                    auto index = slots[slot].index ;
+                    release(slot);
+                    loadPath(index);
+                }
+            }
+            while (next < direct.size()){
+                loadPath(direct[next++]);
+            }
+            break;
+        }
+        ring->reap([&](std::uint64_t slot,int result){
+            auto &pending = slots[slot] ;
+            pending.reading = false ;
+            if ((result == -EINTR) || (result == -EAGAIN)){
+                readNext(slot);
+                return ;
+            }
+            if (result < 0){
+                // Such as a kernel without IORING_OP_READ
+                auto index = pending.index ;
+                release(slot);
+                inflight-- ;
+                loadPath(index);
+                return ;
+            }
+            pending.offset += static_cast<size_t>(result) ;
+            if ((result > 0) && (pending.offset < pending.bytes.size())){
+                readNext(slot);
+                return ;
+            }
+            // Complete (or the file shrank while it was read)
+            pending.bytes.resize(pending.offset);
+            auto index = pending.index ;
+            auto bytes = std::move(pending.bytes) ;
+            release(slot);
+            inflight-- ;
+            decodeBytes(index,std::move(bytes));
+        });
+    }
+#else
+    for (size_t index = 0 ; index<paths.size();index++){
+        loadPath(index);
+    }
+#endif
+}
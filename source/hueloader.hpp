@@ -0,0 +1,47 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#ifndef hueloader_hpp
+#define hueloader_hpp
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <vector>
+#include <filesystem>
+#include <future>
+#include <thread>
+
+#include "huedata.hpp"
+
+//=======================================================================================================================
+// hueloader_t  Loads many hue muls concurrently, handing each back through a future as soon as it is ready.
+// On linux the reads are submitted together through io_uring (up to its queue depth of files at a time, so
+// the open files and buffers stay bounded), and each mul is decoded on a pool of threads as its data lands,
+// while the reads of the others continue. Elsewhere, or when io_uring is refused (an older kernel or a
+// sandbox), the pool reads and decodes the muls itself. Archives (.huez) and stdin are always loaded by the
+// pool, through huestorage_t::load. Journals are replayed as with any other load.
+// The loading runs on a thread of its own, which the destructor waits for.
+//=======================================================================================================================
+class hueloader_t {
+    std::vector<std::filesystem::path> paths ;
+    std::uint32_t huemax ;
+    std::vector<std::promise<huestorage_t>> promises ;
+    std::vector<std::future<huestorage_t>> futures ;
+    std::vector<std::atomic<bool>> settled ;
+    std::thread driver ;
+
+    auto fulfil(size_t index,huestorage_t &&storage) ->void ;
+    auto fail(size_t index,std::exception_ptr error) ->void ;
+    auto run() ->void ;
+    auto dispatch() ->void ;
+public:
+    hueloader_t(const std::vector<std::filesystem::path> &huepaths,std::uint32_t maxnum=3000) ;
+    ~hueloader_t() ;
+    hueloader_t(const hueloader_t&) = delete ;
+    auto operator=(const hueloader_t&) ->hueloader_t& = delete ;
+    auto size() const ->size_t ;
+    // The mul of huepaths[index]. A failed load is rethrown by get()
+    auto operator[](size_t index) ->std::future<huestorage_t>& ;
+};
+
+#endif /* hueloader_hpp */
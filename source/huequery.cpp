@@ -0,0 +1,418 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#include "huequery.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "strutil.hpp"
+#include "huecolumn.hpp"
+#include "huefind.hpp"
+
+using namespace std::string_literals;
+
+namespace {
+    constexpr auto steps = static_cast<size_t>(huecolumns_t::steps) ;
+    const auto opchars = "<>=!~"s ;
+    const auto delimiters = " \t()<>=!~'\""s ;
+
+    //=================================================================================
+    // The smallest (or largest) of the 32 step values of each entry
+    template <typename T>
+    auto reduce(const std::vector<T> &values,std::uint32_t count,bool maximum) ->std::vector<float> {
+        auto rvalue = std::vector<float>(count,0.0f) ;
+        for (size_t id = 0 ; id<count;id++){
+            const auto *step = values.data() + (id*steps) ;
+            auto result = step[0] ;
+            if (maximum){
+                for (size_t j = 1 ; j<steps;j++){
+                    result = std::max(result,step[j]) ;
+                }
+            }
+            else {
+                for (size_t j = 1 ; j<steps;j++){
+                    result = std::min(result,step[j]) ;
+                }
+            }
+            rvalue[id] = static_cast<float>(result) ;
+        }
+        return rvalue ;
+    }
+
+    //=================================================================================
+    // Evaluates the nodes of a query over one table. Each field and the name index are only
+    // built if a predicate asks for them, and then shared by every predicate that does.
+    struct evaluator_t {
+        const std::vector<huequery_t::node_t> &nodes ;
+        const huestorage_t &storage ;
+        huecolumns_t columns ;
+        std::unordered_map<int,std::vector<float>> aggregates ;
+        std::unique_ptr<hueindex_t> index ;
+
+        evaluator_t(const std::vector<huequery_t::node_t> &nodes,const huestorage_t &storage):nodes(nodes),storage(storage),columns(storage){}
+        //=================================================================================
+        auto aggregate(huequery_t::field_t field,bool maximum) ->const std::vector<float>& {
+            auto key = (static_cast<int>(field)*2) + (maximum ? 1 : 0) ;
+            auto iter = aggregates.find(key) ;
+            if (iter != aggregates.end()){
+                return iter->second ;
+            }
+            const auto total = columns.color.size() ;
+            auto result = std::vector<float>() ;
+            if (field == huequery_t::field_t::lum){
+                auto lum = std::vector<float>(total) ;
+                for (size_t j = 0 ; j<total;j++){
+                    lum[j] = (0.2126729f*columns.linearRed[j]) + (0.7151522f*columns.linearGreen[j]) + (0.0721750f*columns.linearBlue[j]) ;
+                }
+                result = reduce(lum,columns.count,maximum) ;
+            }
+            else {
+                auto channel = std::vector<std::uint8_t>(total) ;
+                const auto *color = columns.color.data() ;
+                switch (field){
+                    case huequery_t::field_t::red:
+                        for (size_t j = 0 ; j<total;j++){
+                            channel[j] = static_cast<std::uint8_t>((color[j]>>10)&0x1f) ;
+                        }
+                        break;
+                    case huequery_t::field_t::green:
+                        for (size_t j = 0 ; j<total;j++){
+                            channel[j] = static_cast<std::uint8_t>((color[j]>>5)&0x1f) ;
+                        }
+                        break;
+                    case huequery_t::field_t::blue:
+                        for (size_t j = 0 ; j<total;j++){
+                            channel[j] = static_cast<std::uint8_t>(color[j]&0x1f) ;
+                        }
+                        break;
+                    default:
+                        for (size_t j = 0 ; j<total;j++){
+                            auto red = static_cast<std::uint8_t>((color[j]>>10)&0x1f) ;
+                            auto green = static_cast<std::uint8_t>((color[j]>>5)&0x1f) ;
+                            auto blue = static_cast<std::uint8_t>(color[j]&0x1f) ;
+                            channel[j] = std::max(red,std::max(green,blue)) ;
+                        }
+                        break;
+                }
+                result = reduce(channel,columns.count,maximum) ;
+            }
+            return aggregates.emplace(key,std::move(result)).first->second ;
+        }
+        //=================================================================================
+        auto compare(const huequery_t::node_t &node) ->std::vector<std::uint8_t> {
+            const auto &values = aggregate(node.field,node.maximum) ;
+            const auto bound = node.value ;
+            auto mask = std::vector<std::uint8_t>(values.size(),0) ;
+            auto apply = [&values,&mask](auto predicate){
+                for (size_t j = 0 ; j<values.size();j++){
+                    mask[j] = static_cast<std::uint8_t>(predicate(values[j])) ;
+                }
+            };
+            switch (node.op){
+                case huequery_t::op_t::less:
+                    apply([bound](float value){return value < bound;});
+                    break;
+                case huequery_t::op_t::lessequal:
+                    apply([bound](float value){return value <= bound;});
+                    break;
+                case huequery_t::op_t::greater:
+                    apply([bound](float value){return value > bound;});
+                    break;
+                case huequery_t::op_t::greaterequal:
+                    apply([bound](float value){return value >= bound;});
+                    break;
+                case huequery_t::op_t::equal:
+                    apply([bound](float value){return value == bound;});
+                    break;
+                case huequery_t::op_t::notequal:
+                    apply([bound](float value){return value != bound;});
+                    break;
+            }
+            return mask ;
+        }
+        //=================================================================================
+        auto evaluate(size_t which) ->std::vector<std::uint8_t> {
+            const auto &node = nodes[which] ;
+            const auto count = static_cast<size_t>(columns.count) ;
+            switch (node.kind){
+                case huequery_t::kind_t::both:{
+                    auto mask = evaluate(node.left) ;
+                    auto other = evaluate(node.right) ;
+                    for (size_t j = 0 ; j<count;j++){
+                        mask[j] &= other[j] ;
+                    }
+                    return mask ;
+                }
+                case huequery_t::kind_t::either:{
+                    auto mask = evaluate(node.left) ;
+                    auto other = evaluate(node.right) ;
+                    for (size_t j = 0 ; j<count;j++){
+                        mask[j] |= other[j] ;
+                    }
+                    return mask ;
+                }
+                case huequery_t::kind_t::negate:{
+                    auto mask = evaluate(node.left) ;
+                    for (size_t j = 0 ; j<count;j++){
+                        mask[j] ^= 1 ;
+                    }
+                    return mask ;
+                }
+                case huequery_t::kind_t::blank:
+                    return columns.blank ;
+                case huequery_t::kind_t::id:{
+                    auto mask = std::vector<std::uint8_t>(count,0) ;
+                    for (const auto &id:node.ids){
+                        if (id < count){
+                            mask[id] = 1 ;
+                        }
+                    }
+                    return mask ;
+                }
+                case huequery_t::kind_t::name:{
+                    if (!index){
+                        index = std::make_unique<hueindex_t>(storage) ;
+                    }
+                    auto mask = std::vector<std::uint8_t>(count,0) ;
+                    for (const auto &id:index->find(node.pattern)){
+                        mask[id] = 1 ;
+                    }
+                    return mask ;
+                }
+                case huequery_t::kind_t::has:{
+                    auto mask = std::vector<std::uint8_t>(count,0) ;
+                    const auto *color = columns.color.data() ;
+                    for (size_t id = 0 ; id<count;id++){
+                        auto found = std::uint8_t(0) ;
+                        for (size_t j = 0 ; j<steps;j++){
+                            found |= static_cast<std::uint8_t>((color[(id*steps)+j]&0x7fff) == node.color) ;
+                        }
+                        mask[id] = found ;
+                    }
+                    return mask ;
+                }
+                case huequery_t::kind_t::compare:
+                    return compare(node) ;
+            }
+            return std::vector<std::uint8_t>(count,0) ;
+        }
+    };
+}
+
+//=======================================================================================================================
+// huequery_t
+//=======================================================================================================================
+
+//=======================================================================================================================
+huequery_t::huequery_t(std::string_view expression){
+    tokenize(expression);
+    if (tokens.empty()){
+        throw std::runtime_error("No select expression given");
+    }
+    root = parseOr() ;
+    if (position != tokens.size()){
+        throw std::runtime_error("Unexpected '"s + tokens[position] + "' in select expression");
+    }
+    tokens.clear() ;
+}
+//=======================================================================================================================
+// Tokens are parentheses, operators, quoted strings, and runs of anything else up to a space
+auto huequery_t::tokenize(std::string_view expression) ->void {
+    auto offset = size_t(0) ;
+    while (offset < expression.size()){
+        auto ch = expression[offset] ;
+        if ((ch == ' ') || (ch == '\t')){
+            offset++ ;
+        }
+        else if ((ch == '(') || (ch == ')')){
+            tokens.push_back(std::string(1,ch));
+            offset++ ;
+        }
+        else if ((ch == '\'') || (ch == '"')){
+            auto end = expression.find(ch,offset+1) ;
+            if (end == std::string_view::npos){
+                throw std::runtime_error("Unterminated quote in select expression");
+            }
+            tokens.push_back(std::string(expression.substr(offset+1,end-offset-1)));
+            offset = end + 1 ;
+        }
+        else if (opchars.find(ch) != std::string::npos){
+            auto length = ((offset+1 < expression.size()) && (expression[offset+1] == '=')) ? 2 : 1 ;
+            tokens.push_back(std::string(expression.substr(offset,length)));
+            offset += length ;
+        }
+        else {
+            auto end = expression.find_first_of(delimiters,offset) ;
+            if (end == std::string_view::npos){
+                end = expression.size() ;
+            }
+            tokens.push_back(std::string(expression.substr(offset,end-offset)));
+            offset = end ;
+        }
+    }
+}
+//=======================================================================================================================
+auto huequery_t::peek() const ->std::string {
+    return position < tokens.size() ? strutil::lower(tokens[position]) : ""s ;
+}
+//=======================================================================================================================
+auto huequery_t::next() ->std::string {
+    if (position >= tokens.size()){
+        throw std::runtime_error("Incomplete select expression");
+    }
+    return tokens[position++] ;
+}
+//=======================================================================================================================
+auto huequery_t::add(node_t &&node) ->size_t {
+    nodes.push_back(std::move(node));
+    return nodes.size()-1 ;
+}
+//=======================================================================================================================
+auto huequery_t::parseOr() ->size_t {
+    auto left = parseAnd() ;
+    while (peek() == "or"){
+        position++ ;
+        auto node = node_t() ;
+        node.kind = kind_t::either ;
+        node.left = left ;
+        node.right = parseAnd() ;
+        left = add(std::move(node)) ;
+    }
+    return left ;
+}
+//=======================================================================================================================
+auto huequery_t::parseAnd() ->size_t {
+    auto left = parseUnary() ;
+    while (peek() == "and"){
+        position++ ;
+        auto node = node_t() ;
+        node.kind = kind_t::both ;
+        node.left = left ;
+        node.right = parseUnary() ;
+        left = add(std::move(node)) ;
+    }
+    return left ;
+}
+//=======================================================================================================================
+auto huequery_t::parseUnary() ->size_t {
+    auto word = peek() ;
+    if (word == "not"){
+        position++ ;
+        auto node = node_t() ;
+        node.kind = kind_t::negate ;
+        node.left = parseUnary() ;
+        return add(std::move(node)) ;
+    }
+    if (word == "("){
+        position++ ;
+        auto rvalue = parseOr() ;
+        if (next() != ")"){
+            throw std::runtime_error("Missing ) in select expression");
+        }
+        return rvalue ;
+    }
+    return parsePredicate() ;
+}
+//=======================================================================================================================
+auto huequery_t::parsePredicate() ->size_t {
+    auto word = strutil::lower(next()) ;
+    auto node = node_t() ;
+    if (word == "blank"){
+        node.kind = kind_t::blank ;
+        return add(std::move(node)) ;
+    }
+    const auto operators = std::unordered_map<std::string,op_t>{
+        {"<"s,op_t::less},{"<="s,op_t::lessequal},{">"s,op_t::greater},
+        {">="s,op_t::greaterequal},{"="s,op_t::equal},{"!="s,op_t::notequal}
+    };
+    auto op = next() ;
+    auto value = next() ;
+    auto expect = [&word,&op](const std::string &wanted){
+        if (op != wanted){
+            throw std::runtime_error("Expected "s + word + wanted + " in select expression");
+        }
+    };
+    if (word == "id"){
+        expect("="s);
+        node.kind = kind_t::id ;
+        node.ids = determine_ids(value) ;
+    }
+    else if (word == "name"){
+        expect("~"s);
+        node.kind = kind_t::name ;
+        node.pattern = value ;
+    }
+    else if (word == "has"){
+        expect("="s);
+        node.kind = kind_t::has ;
+        node.color = huecolor_t(value).color & 0x7fff ;
+    }
+    else {
+        const auto fields = std::unordered_map<std::string,field_t>{
+            {"red"s,field_t::red},{"green"s,field_t::green},{"blue"s,field_t::blue},
+            {"bright"s,field_t::bright},{"lum"s,field_t::lum}
+        };
+        auto [name,aggregate] = strutil::split_view(word,".") ;
+        auto field = fields.find(std::string(name)) ;
+        if ((field == fields.end()) || ((aggregate != "min") && (aggregate != "max"))){
+            throw std::runtime_error("Unknown select predicate: "s + word);
+        }
+        auto iter = operators.find(op) ;
+        if (iter == operators.end()){
+            throw std::runtime_error("Unknown select operator: "s + op);
+        }
+        char *end = nullptr ;
+        node.value = std::strtof(value.c_str(),&end) ;
+        if (value.empty() || (end != value.c_str()+value.size())){
+            throw std::runtime_error("Invalid select value: "s + value);
+        }
+        node.kind = kind_t::compare ;
+        node.field = field->second ;
+        node.maximum = aggregate == "max" ;
+        node.op = iter->second ;
+    }
+    return add(std::move(node)) ;
+}
+//=======================================================================================================================
+auto huequery_t::select(const huestorage_t &storage) const ->std::vector<std::uint32_t> {
+    auto evaluator = evaluator_t(nodes,storage) ;
+    auto mask = evaluator.evaluate(root) ;
+    auto rvalue = std::vector<std::uint32_t>() ;
+    for (std::uint32_t id = 0 ; id<mask.size();id++){
+        if (mask[id] != 0){
+            rvalue.push_back(id);
+        }
+    }
+    return rvalue ;
+}
+
+//=======================================================================================================================
+auto writeSelection(const huestorage_t &storage,const std::vector<std::uint32_t> &ids,const std::string &format,std::ostream &output) ->void {
+    if (format == "csv"){
+        output << huestorage_t::text_header<<"\n" ;
+        for (const auto &id:ids){
+            output <<id<<","<<storage[id].description()<<"\n" ;
+        }
+    }
+    else if (format == "json"){
+        output <<"[" ;
+        for (size_t j = 0 ; j<ids.size();j++){
+            const auto &entry = storage[ids[j]] ;
+            output <<(j==0?"\n":",\n")<<"  {\"id\": "<<ids[j]<<", \"name\": \""<<strutil::escapeJSON(entry.name())<<"\", \"colors\": [" ;
+            for (auto step = 0 ; step<huecolumns_t::steps;step++){
+                output <<(step==0?"":", ")<<"\""<<entry[step].description()<<"\"" ;
+            }
+            output <<"]}" ;
+        }
+        output <<(ids.empty()?"]\n":"\n]\n") ;
+    }
+    else {
+        for (const auto &id:ids){
+            output <<id<<"\n" ;
+        }
+    }
+    output.flush();
+}
@@ -0,0 +1,76 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#ifndef huequery_hpp
+#define huequery_hpp
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <ostream>
+
+#include "huedata.hpp"
+
+//=======================================================================================================================
+// huequery_t  A predicate over the entries of a hue table, parsed once from an expression such as
+//      not blank and bright.max<8 and name~*shadow*
+// Predicates are combined with and, or, not and parentheses (and binds tighter than or):
+//      blank                   the entry is blank
+//      id=1,5,10-20            the id is in the list
+//      name~pattern            the name matches the glob (ignoring case, as --find)
+//      has=r:g:b               one of the 32 colors is r:g:b (5 bit channels)
+//      field.min op value      the smallest (or .max largest) value of field over the 32 colors,
+//                              where field is red, green, blue, bright (the largest channel, all 0-31)
+//                              or lum (relative luminance 0-1), and op is < <= > >= = or !=
+// A value holding spaces or parentheses can be quoted with ' or ".
+// The table is evaluated a predicate at a time over its columns, each predicate producing a mask of
+// the entries, so the inner loops run over contiguous arrays without branches.
+//=======================================================================================================================
+class huequery_t {
+public:
+    enum class kind_t {
+        both,either,negate,blank,id,name,has,compare
+    };
+    enum class field_t {
+        red,green,blue,bright,lum
+    };
+    enum class op_t {
+        less,lessequal,greater,greaterequal,equal,notequal
+    };
+    struct node_t {
+        kind_t kind = kind_t::blank ;
+        size_t left = 0 ;
+        size_t right = 0 ;
+        field_t field = field_t::red ;
+        bool maximum = false ;
+        op_t op = op_t::equal ;
+        float value = 0.0f ;
+        std::uint16_t color = 0 ;
+        std::vector<std::uint32_t> ids ;
+        std::string pattern ;
+    };
+private:
+    std::vector<node_t> nodes ;
+    size_t root = 0 ;
+
+    std::vector<std::string> tokens ;
+    size_t position = 0 ;
+    auto tokenize(std::string_view expression) ->void ;
+    auto peek() const ->std::string ;
+    auto next() ->std::string ;
+    auto parseOr() ->size_t ;
+    auto parseAnd() ->size_t ;
+    auto parseUnary() ->size_t ;
+    auto parsePredicate() ->size_t ;
+    auto add(node_t &&node) ->size_t ;
+public:
+    huequery_t(std::string_view expression) ;
+    // Returns the ids of the entries that match, in id order
+    auto select(const huestorage_t &storage) const ->std::vector<std::uint32_t> ;
+};
+
+//=======================================================================================================================
+// Writes the selected entries as ids (one per line), csv (as --extract) or json
+auto writeSelection(const huestorage_t &storage,const std::vector<std::uint32_t> &ids,const std::string &format,std::ostream &output) ->void ;
+
+#endif /* huequery_hpp */
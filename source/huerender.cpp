@@ -0,0 +1,201 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#include "huerender.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "colorspace.hpp"
+#include "hueimage.hpp"
+#include "parallel.hpp"
+
+using namespace std::string_literals;
+
+//=======================================================================================================================
+// 3x5 digits, a row of three bits per line, top line in the high bits
+inline constexpr auto digits = std::array<std::uint16_t,10>{
+    0b111'101'101'101'111, 0b010'110'010'010'111, 0b111'001'111'100'111, 0b111'001'111'001'111, 0b101'101'111'001'001,
+    0b111'100'111'001'111, 0b111'100'111'101'111, 0b111'001'010'010'010, 0b111'101'111'101'111, 0b111'101'111'001'111
+};
+inline constexpr auto glyphWidth = 4 ;      // 3 and a space
+inline constexpr auto swatchWidth = 3 ;
+inline constexpr auto rowHeight = 6 ;       // 5 and a space
+inline constexpr auto gutter = 4 ;
+inline constexpr auto bandRows = std::uint32_t(64) ;
+
+using rgb_t = std::array<std::uint8_t,3> ;
+inline constexpr auto background = rgb_t{0x20,0x20,0x20} ;
+inline constexpr auto labelColor = rgb_t{0xc0,0xc0,0xc0} ;
+inline constexpr auto blankLabel = rgb_t{0x60,0x60,0x60} ;
+inline constexpr auto changedLabel = rgb_t{0xff,0x50,0x50} ;
+inline constexpr auto checker = std::array<rgb_t,2>{rgb_t{0x40,0x40,0x40},rgb_t{0x70,0x70,0x70}} ;
+
+//=======================================================================================================================
+// The colors of a table, expanded to 8 bits, and which entries are blank
+struct ramps_t {
+    std::vector<rgb_t> colors ;
+    std::vector<bool> blank ;
+    ramps_t(const huestorage_t &storage,size_t count):colors(count*32,background),blank(count,true){
+        for (std::uint32_t id = 0 ; id<std::min(count,storage.size());id++){
+            const auto &entry = storage[id] ;
+            blank[id] = entry.empty() ;
+            for (auto j = 0 ; j<32;j++){
+                auto color = entry[j].color ;
+                colors[(id*32)+j] = rgb_t{colorspace::rgb888[colorspace::red(color)],colorspace::rgb888[colorspace::green(color)],colorspace::rgb888[colorspace::blue(color)]} ;
+            }
+        }
+    }
+};
+
+//=======================================================================================================================
+// sheet_t  The layout of a sheet of one or more ramps per entry
+//=======================================================================================================================
+class sheet_t {
+    std::vector<const ramps_t*> tables ;
+    std::vector<bool> changed ;
+    std::uint32_t count ;
+    std::uint32_t places ;
+    std::uint32_t labelWidth ;
+    std::uint32_t columnWidth ;
+    std::uint32_t columns ;
+    std::uint32_t rows ;
+    
+    static auto put(std::uint8_t *pixel,const rgb_t &color) ->void {
+        pixel[0] = color[0] ;
+        pixel[1] = color[1] ;
+        pixel[2] = color[2] ;
+    }
+    //=================================================================================
+    // One pixel line of the row of an entry, starting at pixel
+    auto drawEntry(std::uint8_t *pixel,std::uint32_t id,std::uint32_t line) const ->void {
+        auto blank = std::all_of(tables.begin(),tables.end(),[id](const ramps_t *table){
+            return table->blank[id] ;
+        });
+        const auto &ink = changed[id] ? changedLabel : (blank ? blankLabel : labelColor) ;
+        auto text = std::to_string(id) ;
+        auto x = std::uint32_t(1) + ((places - static_cast<std::uint32_t>(text.size()))*glyphWidth) ;
+        for (auto letter:text){
+            auto bits = (digits[letter-'0'] >> ((4-line)*3)) & 7 ;
+            for (auto j = 0 ; j<3;j++){
+                if (bits & (4>>j)){
+                    put(pixel + ((x+j)*3),ink);
+                }
+            }
+            x += glyphWidth ;
+        }
+        x = labelWidth ;
+        for (const auto &table:tables){
+            for (auto j = 0 ; j<32;j++){
+                for (auto k = 0 ; k<swatchWidth;k++){
+                    put(pixel + ((x+k)*3),table->blank[id] ? checker[((x+k)/2 + line/2)&1] : table->colors[(id*32)+j]);
+                }
+                x += swatchWidth ;
+            }
+            x += 2 ;
+        }
+    }
+public:
+    std::uint32_t width ;
+    std::uint32_t height ;
+    
+    sheet_t(std::vector<const ramps_t*> ramps,std::vector<bool> differ,std::uint32_t entries):tables(std::move(ramps)),changed(std::move(differ)),count(entries){
+        places = static_cast<std::uint32_t>(std::to_string(std::max<std::uint32_t>(count,1)-1).size()) ;
+        labelWidth = 1 + (places*glyphWidth) + 1 ;
+        columnWidth = labelWidth + (static_cast<std::uint32_t>(tables.size())*((32*swatchWidth)+2)) + gutter ;
+        columns = std::max<std::uint32_t>(1,static_cast<std::uint32_t>(std::ceil(std::sqrt(double(count)*rowHeight/columnWidth)))) ;
+        rows = std::max<std::uint32_t>(1,(count + columns - 1)/columns) ;
+        columns = std::max<std::uint32_t>(1,(count + rows - 1)/rows) ;
+        width = columns*columnWidth ;
+        height = rows*rowHeight ;
+    }
+    //=================================================================================
+    auto drawLine(std::uint8_t *pixels,std::uint32_t y) const ->void {
+        for (std::uint32_t x = 0 ; x<width;x++){
+            put(pixels + (x*3),background);
+        }
+        auto line = y%rowHeight ;
+        if (line >= 5){
+            return ;
+        }
+        for (std::uint32_t column = 0 ; column<columns;column++){
+            auto id = (column*rows) + (y/rowHeight) ;
+            if (id < count){
+                drawEntry(pixels + (column*columnWidth*3),id,line);
+            }
+        }
+    }
+    //=================================================================================
+    auto render(const std::filesystem::path &imagepath) const ->void {
+        auto writer = imagewriter_t(imagepath,width,height) ;
+        auto stride = std::size_t(width)*3 ;
+        auto bands = static_cast<std::size_t>((height + bandRows - 1)/bandRows) ;
+        // One thread per chunk, each drawing every workers'th band into a band of its own, and the
+        // threads take turns (in band order) to write them, so only a band per thread is held
+        auto workers = parallel::threads(bands) ;
+        auto turn = std::mutex() ;
+        auto ready = std::condition_variable() ;
+        auto next = std::size_t(0) ;
+        auto failed = false ;
+        parallel::forEach(workers, [&,this](size_t,size_t,size_t worker){
+            auto band = std::vector<std::uint8_t>(stride*bandRows) ;
+            try {
+                for (auto index = worker ; index<bands;index+=workers){
+                    auto top = static_cast<std::uint32_t>(index)*bandRows ;
+                    auto lines = std::min(bandRows,height-top) ;
+                    for (std::uint32_t line = 0 ; line<lines;line++){
+                        drawLine(band.data() + (line*stride),top+line);
+                    }
+                    auto lock = std::unique_lock<std::mutex>(turn) ;
+                    ready.wait(lock,[&]{return failed || (next == index);});
+                    if (failed){
+                        return ;
+                    }
+                    writer.write(band.data(),lines);
+                    next++ ;
+                    ready.notify_all();
+                }
+            }
+            catch (...){
+                // Wake the others, who would otherwise wait for this thread's band
+                {
+                    auto lock = std::lock_guard<std::mutex>(turn) ;
+                    failed = true ;
+                }
+                ready.notify_all();
+                throw ;
+            }
+        });
+        writer.close();
+    }
+};
+
+//=======================================================================================================================
+auto renderSheet(const huestorage_t &storage,const std::filesystem::path &imagepath) ->void {
+    if (storage.empty()){
+        throw std::runtime_error("No hues to render.");
+    }
+    auto count = static_cast<std::uint32_t>(storage.size()) ;
+    auto ramps = ramps_t(storage,count) ;
+    sheet_t({&ramps},std::vector<bool>(count,false),count).render(imagepath);
+}
+//=======================================================================================================================
+auto renderDiff(const huestorage_t &left,const huestorage_t &right,const std::filesystem::path &imagepath) ->void {
+    auto count = static_cast<std::uint32_t>(std::max(left.size(),right.size())) ;
+    if (count == 0){
+        throw std::runtime_error("No hues to render.");
+    }
+    auto changed = std::vector<bool>(count,false) ;
+    for (const auto &id:left.changed(right)){
+        changed[id] = true ;
+    }
+    auto leftramps = ramps_t(left,count) ;
+    auto rightramps = ramps_t(right,count) ;
+    sheet_t({&leftramps,&rightramps},std::move(changed),count).render(imagepath);
+}
@@ -0,0 +1,22 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#ifndef huerender_hpp
+#define huerender_hpp
+
+#include <filesystem>
+
+#include "huedata.hpp"
+
+//=======================================================================================================================
+// Contact sheets of hue tables. Each entry is a row: its id (in a 3x5 pixel font), then its 32 colors
+// as swatches. Blank entries are drawn as a checker, and the rows are laid out in enough columns to
+// keep the sheet roughly square. The sheet is rendered in bands of rows, each thread drawing whole
+// bands in turn (round robin), and the bands are written in order (ppm or png, by extension) as
+// they are finished.
+// The diff sheet puts the ramps of the two tables side by side, with the ids of the entries that
+// differ drawn in red.
+//=======================================================================================================================
+auto renderSheet(const huestorage_t &storage,const std::filesystem::path &imagepath) ->void ;
+auto renderDiff(const huestorage_t &left,const huestorage_t &right,const std::filesystem::path &imagepath) ->void ;
+
+#endif /* huerender_hpp */
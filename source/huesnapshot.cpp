@@ -0,0 +1,53 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#include "huesnapshot.hpp"
+
+#include <utility>
+
+//=======================================================================================================================
+// huesnapshot_t
+//=======================================================================================================================
+
+//=======================================================================================================================
+huesnapshot_t::huesnapshot_t(huestorage_t storage):current(std::make_shared<const huestorage_t>(std::move(storage))),version(0){
+}
+//=======================================================================================================================
+auto huesnapshot_t::store(snapshot_t table) ->void {
+#if defined(__cpp_lib_atomic_shared_ptr)
+    current.store(std::move(table),std::memory_order_release);
+#else
+    std::atomic_store_explicit(&current,std::move(table),std::memory_order_release);
+#endif
+}
+//=======================================================================================================================
+// The current version. Hold on to it for a batch of lookups, rather than taking one per lookup
+auto huesnapshot_t::snapshot() const ->snapshot_t {
+#if defined(__cpp_lib_atomic_shared_ptr)
+    return current.load(std::memory_order_acquire);
+#else
+    return std::atomic_load_explicit(&current,std::memory_order_acquire);
+#endif
+}
+//=======================================================================================================================
+// The number of versions published since construction
+auto huesnapshot_t::generation() const ->std::uint64_t {
+    return version.load(std::memory_order_acquire);
+}
+//=======================================================================================================================
+// Replaces the table with storage, returning the new generation
+auto huesnapshot_t::publish(huestorage_t storage) ->std::uint64_t {
+    auto table = std::make_shared<const huestorage_t>(std::move(storage)) ;
+    auto lock = std::lock_guard<std::mutex>(writer) ;
+    store(std::move(table));
+    return ++version ;
+}
+//=======================================================================================================================
+// Applies edit to a copy of the current table and publishes it, returning the new generation.
+// If edit throws, nothing is published.
+auto huesnapshot_t::update(const std::function<void(huestorage_t&)> &edit) ->std::uint64_t {
+    auto lock = std::lock_guard<std::mutex>(writer) ;
+    auto next = huestorage_t(*snapshot()) ;
+    edit(next) ;
+    store(std::make_shared<const huestorage_t>(std::move(next)));
+    return ++version ;
+}
@@ -0,0 +1,49 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#ifndef huesnapshot_hpp
+#define huesnapshot_hpp
+
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <functional>
+
+#include "huedata.hpp"
+
+//=======================================================================================================================
+// huesnapshot_t  Publishes versions of a hue table to many reader threads.
+// Readers take a snapshot, an immutable reference counted version of the table, and do their
+// lookups against it without locking. Taking the snapshot is not lock free: the standard library
+// guards an atomic shared_ptr with a (spin)lock of its own, held just for the pointer copy, so
+// readers should take one snapshot per batch of lookups. A snapshot stays valid for as long as it
+// is held, no matter how many versions are published after it. Writers copy the current version,
+// change the copy, and publish it atomically. Writers are serialized with each other (by a mutex
+// readers never take).
+//=======================================================================================================================
+class huesnapshot_t {
+public:
+    using snapshot_t = std::shared_ptr<const huestorage_t> ;
+private:
+#if defined(__cpp_lib_atomic_shared_ptr)
+    std::atomic<snapshot_t> current ;
+#else
+    snapshot_t current ;    // Only accessed through std::atomic_load/std::atomic_store
+#endif
+    std::atomic<std::uint64_t> version ;
+    std::mutex writer ;
+    
+    auto store(snapshot_t table) ->void ;
+public:
+    huesnapshot_t(huestorage_t storage = huestorage_t()) ;
+    huesnapshot_t(const huesnapshot_t&) = delete ;
+    auto operator=(const huesnapshot_t&) ->huesnapshot_t& = delete ;
+    
+    auto snapshot() const ->snapshot_t ;
+    auto generation() const ->std::uint64_t ;
+    
+    auto publish(huestorage_t storage) ->std::uint64_t ;
+    auto update(const std::function<void(huestorage_t&)> &edit) ->std::uint64_t ;
+};
+
+#endif /* huesnapshot_hpp */
@@ -0,0 +1,157 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#include "huesort.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+#include "colorspace.hpp"
+#include "parallel.hpp"
+#include "strutil.hpp"
+
+using namespace std::string_literals;
+
+//=======================================================================================================================
+// The ramp is sampled at these steps for the similarity distance
+constexpr auto samplecount = 8 ;
+constexpr auto featuresize = samplecount*3 ;
+
+//=======================================================================================================================
+auto sortKey(const std::string &name) ->huesort_t {
+    auto key = strutil::lower(name) ;
+    if (key == "hue"){
+        return huesort_t::hue ;
+    }
+    if (key == "luminance"){
+        return huesort_t::luminance ;
+    }
+    if (key == "similarity"){
+        return huesort_t::similarity ;
+    }
+    throw std::runtime_error("Unknown sort key (hue, luminance, or similarity): "s + name);
+}
+//=======================================================================================================================
+// Sort keys for hue and luminance: (gray, angle, luminance) and (luminance)
+auto rampKey(const hueentry_t &entry,huesort_t key) ->std::array<float,3> {
+    auto red = 0.0f ;
+    auto green = 0.0f ;
+    auto blue = 0.0f ;
+    auto luminance = 0.0f ;
+    for (auto j = 0 ; j<32;j++){
+        auto color = entry[j].color ;
+        red += colorspace::linear[colorspace::red(color)] ;
+        green += colorspace::linear[colorspace::green(color)] ;
+        blue += colorspace::linear[colorspace::blue(color)] ;
+        luminance += colorspace::luminance(color) ;
+    }
+    luminance /= 32.0f ;
+    if (key == huesort_t::luminance){
+        return {luminance,0.0f,0.0f} ;
+    }
+    auto high = std::max({red,green,blue}) ;
+    auto low = std::min({red,green,blue}) ;
+    auto chroma = high - low ;
+    if ((high <= 0.0f) || ((chroma/high) < 0.1f)){
+        return {1.0f,0.0f,luminance} ;
+    }
+    auto angle = 0.0f ;
+    if (high == red){
+        angle = std::fmod((green-blue)/chroma + 6.0f,6.0f) ;
+    }
+    else if (high == green){
+        angle = ((blue-red)/chroma) + 2.0f ;
+    }
+    else {
+        angle = ((red-green)/chroma) + 4.0f ;
+    }
+    return {0.0f,angle*60.0f,luminance} ;
+}
+//=======================================================================================================================
+// CIELAB of the sampled ramp steps, for the similarity distance
+auto rampFeature(const hueentry_t &entry) ->std::array<float,featuresize> {
+    auto red = std::array<float,samplecount>() ;
+    auto green = std::array<float,samplecount>() ;
+    auto blue = std::array<float,samplecount>() ;
+    for (auto j = 0 ; j<samplecount;j++){
+        auto color = entry[(j*4)+3].color ;
+        red[j] = colorspace::linear[colorspace::red(color)] ;
+        green[j] = colorspace::linear[colorspace::green(color)] ;
+        blue[j] = colorspace::linear[colorspace::blue(color)] ;
+    }
+    auto rvalue = std::array<float,featuresize>() ;
+    colorspace::lab(red.data(), green.data(), blue.data(), rvalue.data(), rvalue.data()+samplecount, rvalue.data()+(2*samplecount), samplecount);
+    return rvalue ;
+}
+//=======================================================================================================================
+auto sortHues(huestorage_t &storage,huesort_t key) ->std::vector<std::pair<std::uint32_t,std::uint32_t>> {
+    // Read through a const table, so blank ids are not materialized (only the slots are written back)
+    const auto &table = storage ;
+    auto slots = std::vector<std::uint32_t>() ;
+    for (std::uint32_t id = 1 ; id<table.size();id++){
+        if (!table[id].empty()){
+            slots.push_back(id);
+        }
+    }
+    auto order = std::vector<size_t>(slots.size()) ;
+    std::iota(order.begin(),order.end(),0);
+    if (key == huesort_t::similarity){
+        auto features = std::vector<std::array<float,featuresize>>(slots.size()) ;
+        auto darkness = std::vector<float>(slots.size()) ;
+        parallel::forEach(slots.size(), [&](size_t first,size_t last,size_t){
+            for (auto j = first ; j<last;j++){
+                features[j] = rampFeature(table[slots[j]]) ;
+                darkness[j] = rampKey(table[slots[j]],huesort_t::luminance)[0] ;
+            }
+        });
+        // Greedy chain: start at the darkest, and always step to the closest remaining entry
+        if (!order.empty()){
+            std::swap(order[0], order[static_cast<size_t>(std::min_element(darkness.begin(),darkness.end())-darkness.begin())]);
+            for (size_t current = 0 ; current+1<order.size();current++){
+                const auto &from = features[order[current]] ;
+                auto best = current+1 ;
+                auto bestdistance = std::numeric_limits<float>::max() ;
+                for (auto j = current+1 ; j<order.size();j++){
+                    const auto &to = features[order[j]] ;
+                    auto distance = 0.0f ;
+                    for (auto k = 0 ; k<featuresize;k++){
+                        auto delta = from[k]-to[k] ;
+                        distance += delta*delta ;
+                    }
+                    if ((distance < bestdistance) || ((distance == bestdistance) && (order[j] < order[best]))){
+                        bestdistance = distance ;
+                        best = j ;
+                    }
+                }
+                std::swap(order[current+1],order[best]);
+            }
+        }
+    }
+    else {
+        auto keys = std::vector<std::array<float,3>>(slots.size()) ;
+        parallel::forEach(slots.size(), [&](size_t first,size_t last,size_t){
+            for (auto j = first ; j<last;j++){
+                keys[j] = rampKey(table[slots[j]],key) ;
+            }
+        });
+        std::stable_sort(order.begin(),order.end(),[&keys](size_t lhs,size_t rhs){
+            return keys[lhs] < keys[rhs] ;
+        });
+    }
+    auto entries = std::vector<hueentry_t>() ;
+    entries.reserve(slots.size());
+    for (const auto &index:order){
+        entries.push_back(table[slots[index]]);
+    }
+    auto rvalue = std::vector<std::pair<std::uint32_t,std::uint32_t>>() ;
+    rvalue.reserve(slots.size());
+    for (size_t j = 0 ; j<slots.size();j++){
+        storage[slots[j]] = entries[j] ;
+        rvalue.push_back(std::make_pair(slots[order[j]],slots[j]));
+    }
+    std::sort(rvalue.begin(),rvalue.end());
+    return rvalue ;
+}
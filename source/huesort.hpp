@@ -0,0 +1,30 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#ifndef huesort_hpp
+#define huesort_hpp
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "huedata.hpp"
+
+//=======================================================================================================================
+// Perceptual reordering of a hue table.
+// Only entries that are not blank, and not the reserved id 0, are moved. They are reordered amongst
+// the ids they already occupy, so blank entries stay where they are.
+//     hue         by the hue angle of the average ramp color (grays last, by luminance)
+//     luminance   by the average luminance of the ramp
+//     similarity  greedy nearest neighbour chain, starting from the darkest entry, over the CIELAB
+//                 colors sampled along the ramp
+//=======================================================================================================================
+enum class huesort_t {
+    hue,luminance,similarity
+};
+
+auto sortKey(const std::string &name) ->huesort_t ;
+// Returns the (old id, new id) pairs for every entry that was considered
+auto sortHues(huestorage_t &storage,huesort_t key) ->std::vector<std::pair<std::uint32_t,std::uint32_t>> ;
+
+#endif /* huesort_hpp */
@@ -0,0 +1,381 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#include "huesplice.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "huearchive.hpp"
+#include "huedata.hpp"
+#include "huejournal.hpp"
+#include "strutil.hpp"
+
+using namespace std::string_literals;
+
+//=======================================================================================================================
+// Where each destination id comes from
+struct huesource_t {
+    static constexpr auto blank = std::uint32_t(0xFFFFFFFF) ;
+    std::uint32_t file ;
+    std::uint32_t id ;
+};
+
+//=======================================================================================================================
+// rawcopy_t  Writes a destination from byte ranges of the source files. Adjacent ranges are coalesced,
+// so a run of whole groups becomes a single copy.
+//=======================================================================================================================
+class rawcopy_t {
+    struct pending_t {
+        std::uint32_t file ;
+        std::uint64_t offset ;
+        std::uint64_t length ;
+    };
+    pending_t pending ;
+    std::vector<std::filesystem::path> names ;
+#if defined(__linux__)
+    std::vector<int> sources ;
+    int destination ;
+    bool kernel ;
+#else
+    std::vector<std::ifstream> sources ;
+    std::ofstream destination ;
+#endif
+    auto transfer(const pending_t &range) ->void ;
+public:
+    rawcopy_t(const std::vector<std::filesystem::path> &paths,const std::filesystem::path &output) ;
+    ~rawcopy_t() ;
+    rawcopy_t(const rawcopy_t&) = delete ;
+    auto operator=(const rawcopy_t&) ->rawcopy_t& = delete ;
+    auto copy(std::uint32_t file,std::uint64_t offset,std::uint64_t length) ->void ;
+    auto write(const void *data,std::size_t length) ->void ;
+    auto flush() ->void ;
+};
+
+//=======================================================================================================================
+rawcopy_t::rawcopy_t(const std::vector<std::filesystem::path> &paths,const std::filesystem::path &output):pending{0,0,0},names(paths){
+#if defined(__linux__)
+    kernel = true ;
+    destination = -1 ;
+    for (const auto &path:paths){
+        auto fd = ::open(path.string().c_str(),O_RDONLY) ;
+        if (fd < 0){
+            for (auto source:sources){
+                ::close(source);
+            }
+            throw std::runtime_error("Unable to open: "s + path.string());
+        }
+        sources.push_back(fd);
+    }
+    destination = ::open(output.string().c_str(),O_WRONLY|O_CREAT|O_TRUNC,0644) ;
+    if (destination < 0){
+        for (auto source:sources){
+            ::close(source);
+        }
+        throw std::runtime_error("Unable to create: "s + output.string());
+    }
+#else
+    for (const auto &path:paths){
+        sources.emplace_back(path.string(),std::ios::binary);
+        if (!sources.back().is_open()){
+            throw std::runtime_error("Unable to open: "s + path.string());
+        }
+    }
+    destination.open(output.string(),std::ios::binary);
+    if (!destination.is_open()){
+        throw std::runtime_error("Unable to create: "s + output.string());
+    }
+#endif
+}
+//=======================================================================================================================
+rawcopy_t::~rawcopy_t() {
+#if defined(__linux__)
+    for (auto source:sources){
+        ::close(source);
+    }
+    if (destination >= 0){
+        ::close(destination);
+    }
+#endif
+}
+//=======================================================================================================================
+auto rawcopy_t::transfer(const pending_t &range) ->void {
+#if defined(__linux__)
+    auto offset = static_cast<off_t>(range.offset) ;
+    auto remaining = range.length ;
+    while (remaining > 0 && kernel){
+        auto amount = ::copy_file_range(sources[range.file],&offset,destination,nullptr,remaining,0) ;
+        if (amount > 0){
+            remaining -= static_cast<std::uint64_t>(amount) ;
+        }
+        else if (amount == 0){
+            // The source ended before the range (it shrank since it was sized)
+            throw std::runtime_error("Hue data source is truncated: "s + names[range.file].string());
+        }
+        else if ((amount < 0) && (errno == EINTR)){
+            continue;
+        }
+        else if ((amount < 0) && ((errno == ENOSYS) || (errno == EXDEV) || (errno == EINVAL) || (errno == EOPNOTSUPP))){
+            // Not supported between these files, copy through user space from here on
+            kernel = false ;
+        }
+        else {
+            throw std::runtime_error("Unable to copy hue data: "s + std::system_category().message(errno));
+        }
+    }
+    auto buffer = std::vector<char>(64*1024) ;
+    while (remaining > 0){
+        auto amount = ::pread(sources[range.file],buffer.data(),std::min<std::uint64_t>(remaining,buffer.size()),offset) ;
+        if (amount == 0){
+            throw std::runtime_error("Hue data source is truncated: "s + names[range.file].string());
+        }
+        if (amount < 0){
+            throw std::runtime_error("Unable to read hue data: "s + std::system_category().message(errno));
+        }
+        write(buffer.data(),static_cast<std::size_t>(amount));
+        offset += amount ;
+        remaining -= static_cast<std::uint64_t>(amount) ;
+    }
+#else
+    auto &source = sources[range.file] ;
+    source.seekg(range.offset);
+    auto buffer = std::vector<char>(64*1024) ;
+    auto remaining = range.length ;
+    while (remaining > 0){
+        auto amount = std::min<std::uint64_t>(remaining,buffer.size()) ;
+        source.read(buffer.data(),amount);
+        if (source.gcount() != static_cast<std::streamsize>(amount)){
+            throw std::runtime_error("Hue data source is truncated: "s + names[range.file].string());
+        }
+        destination.write(buffer.data(),amount);
+        remaining -= amount ;
+    }
+#endif
+}
+//=======================================================================================================================
+auto rawcopy_t::copy(std::uint32_t file,std::uint64_t offset,std::uint64_t length) ->void {
+    if ((pending.length > 0) && (pending.file == file) && (pending.offset + pending.length == offset)){
+        pending.length += length ;
+        return ;
+    }
+    flush();
+    pending = pending_t{file,offset,length} ;
+}
+//=======================================================================================================================
+auto rawcopy_t::write(const void *data,std::size_t length) ->void {
+    flush();
+#if defined(__linux__)
+    auto bytes = static_cast<const char*>(data) ;
+    while (length > 0){
+        auto amount = ::write(destination,bytes,length) ;
+        if (amount < 0){
+            if (errno == EINTR){
+                continue;
+            }
+            throw std::runtime_error("Unable to write hue data: "s + std::system_category().message(errno));
+        }
+        bytes += amount ;
+        length -= static_cast<std::size_t>(amount) ;
+    }
+#else
+    destination.write(static_cast<const char*>(data),length);
+    if (!destination.good()){
+        throw std::runtime_error("Unable to write hue data.");
+    }
+#endif
+}
+//=======================================================================================================================
+auto rawcopy_t::flush() ->void {
+    if (pending.length > 0){
+        auto range = pending ;
+        pending.length = 0 ;
+        transfer(range);
+    }
+}
+
+//=======================================================================================================================
+// Writes the destination described by map, one HueGroup at a time
+auto assemble(const std::vector<std::filesystem::path> &paths,const std::vector<std::uint64_t> &counts,const std::vector<huesource_t> &map,const std::filesystem::path &output) ->void {
+    auto writer = rawcopy_t(paths,output) ;
+    const auto zero = std::vector<std::uint8_t>(hueentry_size,0) ;
+    constexpr auto groupcount = stock_format::entriesPerGroup ;
+    for (size_t first = 0 ; first<map.size();first+=groupcount){
+        auto last = std::min(first+groupcount,map.size()) ;
+        const auto &start = map[first] ;
+        // A whole group can be copied, header and all, if it maps to a complete aligned source group
+        auto whole = (last-first == groupcount) && (start.file != huesource_t::blank) && stock_format::startsGroup(start.id) && (std::uint64_t(start.id)+groupcount <= counts[start.file]) ;
+        for (auto j = first+1 ; whole && (j<last);j++){
+            whole = (map[j].file == start.file) && (map[j].id == start.id + (j-first)) ;
+        }
+        if (whole){
+            writer.copy(start.file,entryOffset(start.id)-stock_format::headerSize,huegroup_size);
+            continue;
+        }
+        const auto header = std::array<std::uint8_t,stock_format::headerSize>() ;
+        writer.write(header.data(),header.size());
+        for (auto j = first ; j<last;j++){
+            if (map[j].file == huesource_t::blank){
+                writer.write(zero.data(),zero.size());
+            }
+            else {
+                writer.copy(map[j].file,entryOffset(map[j].id),hueentry_size);
+            }
+        }
+    }
+    writer.flush();
+    huejournal_t::discard(output);
+}
+//=======================================================================================================================
+// True if the sources can be copied as raw bytes. A source with a journal has edits that are not in
+// its bytes, and an archive (.huez) is not laid out as a mul, so then every source is loaded (replaying
+// its journal) and the destination is saved whole
+auto rawCopyable(const std::vector<std::filesystem::path> &paths) ->bool {
+    return std::none_of(paths.begin(),paths.end(),[](const std::filesystem::path &path){
+        return isArchive(path) || std::filesystem::exists(huejournal_t::path(path)) ;
+    });
+}
+//=======================================================================================================================
+// Writes the destination described by map from loaded tables
+auto assembleDecoded(const std::vector<huestorage_t> &tables,const std::vector<huesource_t> &map,const std::filesystem::path &output) ->void {
+    auto storage = huestorage_t(static_cast<std::uint32_t>(map.size())) ;
+    for (const auto &source:map){
+        storage.append(source.file == huesource_t::blank ? hueentry_t() : tables[source.file][source.id]);
+    }
+    storage.save(output);
+}
+//=======================================================================================================================
+// Number of entries in a mul, from its size
+auto muls(const std::filesystem::path &path) ->std::uint64_t {
+    if (!std::filesystem::exists(path)){
+        throw std::runtime_error("Does not exist: "s + path.string());
+    }
+    return entryCount(std::filesystem::file_size(path)) ;
+}
+
+//=======================================================================================================================
+auto parseRanges(std::string_view list) ->std::vector<huerange_t> {
+    auto rvalue = std::vector<huerange_t>() ;
+    for (auto entry : strutil::tokenizer(list,",")){
+        if (entry.empty()){
+            continue;
+        }
+        auto [first,last] = strutil::split_view(entry,"-") ;
+        auto range = huerange_t{0,0} ;
+        if (strutil::ston(first,range.first) != std::errc()){
+            throw std::runtime_error("Invalid id range: "s + std::string(entry));
+        }
+        if (entry.find('-') == std::string_view::npos){
+            range.last = range.first ;
+        }
+        else if (last.empty()){
+            range.last = huerange_t::end ;
+        }
+        else if ((strutil::ston(last,range.last) != std::errc()) || (range.last < range.first)){
+            throw std::runtime_error("Invalid id range: "s + std::string(entry));
+        }
+        rvalue.push_back(range);
+    }
+    if (rvalue.empty()){
+        throw std::runtime_error("No id ranges specified");
+    }
+    return rvalue ;
+}
+//=======================================================================================================================
+auto parsePart(std::string_view specification) ->huepart_t {
+    auto loc = specification.rfind('@') ;
+    auto offset = std::uint32_t(0) ;
+    if ((loc == std::string_view::npos) || (strutil::ston(specification.substr(loc+1),offset) != std::errc())){
+        throw std::runtime_error("Part must be path@offset: "s + std::string(specification));
+    }
+    return huepart_t(std::filesystem::path(specification.substr(0,loc)),offset) ;
+}
+
+//=======================================================================================================================
+auto splitMul(const std::filesystem::path &source,const std::vector<huerange_t> &ranges,const std::filesystem::path &directory,std::uint32_t maxnum) ->std::vector<std::filesystem::path> {
+    auto raw = rawCopyable({source}) ;
+    auto tables = std::vector<huestorage_t>() ;
+    if (!raw){
+        tables.emplace_back(source,huerange_t::end);
+    }
+    auto count = raw ? muls(source) : std::uint64_t(tables[0].size()) ;
+    std::filesystem::create_directories(directory);
+    auto rvalue = std::vector<std::filesystem::path>() ;
+    for (const auto &range:ranges){
+        if (range.first >= count){
+            throw std::runtime_error("Range starts past the last id of "s + source.filename().string() + ": "s + std::to_string(range.first));
+        }
+        auto last = std::min<std::uint64_t>(range.last,count-1) ;
+        if (last - range.first + 1 > maxnum){
+            throw std::runtime_error("Exceeds max number of hues of: "s + std::to_string(maxnum));
+        }
+        auto map = std::vector<huesource_t>() ;
+        map.reserve(last - range.first + 1);
+        for (auto id = std::uint64_t(range.first) ; id<=last;id++){
+            map.push_back(huesource_t{0,static_cast<std::uint32_t>(id)});
+        }
+        auto output = directory / (source.stem().string() + "_"s + std::to_string(range.first) + "-"s + std::to_string(last) + source.extension().string()) ;
+        if (raw){
+            assemble({source}, {count}, map, output);
+        }
+        else {
+            assembleDecoded(tables, map, output);
+        }
+        rvalue.push_back(output);
+    }
+    return rvalue ;
+}
+//=======================================================================================================================
+auto spliceMul(const std::filesystem::path &base,const std::vector<huepart_t> &parts,const std::filesystem::path &destination,std::uint32_t maxnum) ->void {
+    auto paths = std::vector<std::filesystem::path>{base} ;
+    for (const auto &part:parts){
+        paths.push_back(part.path);
+    }
+    auto raw = rawCopyable(paths) && !isArchive(destination) ;
+    auto tables = std::vector<huestorage_t>() ;
+    auto counts = std::vector<std::uint64_t>() ;
+    for (const auto &path:paths){
+        if (raw){
+            counts.push_back(muls(path));
+        }
+        else {
+            tables.emplace_back(path,huerange_t::end);
+            counts.push_back(tables.back().size());
+        }
+    }
+    auto size = counts[0] ;
+    for (size_t part = 0 ; part<parts.size();part++){
+        size = std::max(size,std::uint64_t(parts[part].offset)+counts[part+1]) ;
+    }
+    if (size > maxnum){
+        throw std::runtime_error("Exceeds max number of hues of: "s + std::to_string(maxnum));
+    }
+    auto map = std::vector<huesource_t>(size,huesource_t{huesource_t::blank,0}) ;
+    for (std::uint32_t file = 0 ; file<paths.size();file++){
+        auto offset = (file == 0) ? 0 : parts[file-1].offset ;
+        for (std::uint32_t id = 0 ; id<counts[file];id++){
+            map[offset+id] = huesource_t{file,id} ;
+        }
+    }
+    // Writing over one of the inputs would truncate it before it was read
+    for (const auto &path:paths){
+        auto ec = std::error_code() ;
+        if (std::filesystem::equivalent(path,destination,ec)){
+            throw std::runtime_error("Destination can not be one of the sources: "s + destination.string());
+        }
+    }
+    if (raw){
+        assemble(paths, counts, map, destination);
+    }
+    else {
+        assembleDecoded(tables, map, destination);
+    }
+}
@@ -0,0 +1,43 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#ifndef huesplice_hpp
+#define huesplice_hpp
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include <filesystem>
+
+//=======================================================================================================================
+// Split and splice hue muls by id range, without decoding the entries.
+// Whenever a destination HueGroup maps onto a complete, aligned group of a source, the group is
+// copied as raw bytes (kernel side with copy_file_range on linux). Only the groups at unaligned
+// edges are assembled entry by entry, and even those entries are copied, not re-encoded.
+// A source with a journal, and an archive (.huez) source or destination, are the exception: the
+// sources are then loaded (with any journal replayed) and the destination is saved as a whole.
+//=======================================================================================================================
+
+//=======================================================================================================================
+// An inclusive range of ids. "a-b" is a to b, "a" is a single id, and "a-" is a to the end
+struct huerange_t {
+    static constexpr auto end = std::uint32_t(0xFFFFFFFF) ;
+    std::uint32_t first ;
+    std::uint32_t last ;
+};
+auto parseRanges(std::string_view list) ->std::vector<huerange_t> ;
+
+//=======================================================================================================================
+// A mul placed at an id offset of the destination ("path@offset" on the command line)
+struct huepart_t {
+    std::filesystem::path path ;
+    std::uint32_t offset ;
+    huepart_t(const std::filesystem::path &partpath,std::uint32_t partoffset=0):path(partpath),offset(partoffset){}
+};
+auto parsePart(std::string_view specification) ->huepart_t ;
+
+// Writes each range of source to its own mul in directory (ids are renumbered from 0). Returns the files made
+auto splitMul(const std::filesystem::path &source,const std::vector<huerange_t> &ranges,const std::filesystem::path &directory,std::uint32_t maxnum=3000) ->std::vector<std::filesystem::path> ;
+// Writes base with each part laid over it in order (later parts win), growing it as needed
+auto spliceMul(const std::filesystem::path &base,const std::vector<huepart_t> &parts,const std::filesystem::path &destination,std::uint32_t maxnum=3000) ->void ;
+
+#endif /* huesplice_hpp */
@@ -0,0 +1,181 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#include "huestats.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <utility>
+
+#include "colorspace.hpp"
+#include "hueloader.hpp"
+#include "parallel.hpp"
+#include "strutil.hpp"
+
+using namespace std::string_literals;
+
+//=======================================================================================================================
+// huestats_t
+//=======================================================================================================================
+
+//=======================================================================================================================
+// The tables are loaded concurrently (see hueloader_t), and then every entry of every table is spread over the threads.
+// Each thread reduces into its own histogram, and the partial results are summed at the end.
+huestats_t::huestats_t(const std::vector<std::filesystem::path> &paths,std::uint32_t maxnum):blanks(0),histogram(32768,0),bands{}{
+    auto storages = std::vector<huestorage_t>() ;
+    auto loader = hueloader_t(paths,maxnum) ;
+    for (size_t j = 0 ; j<loader.size();j++){
+        storages.push_back(loader[j].get());
+    }
+    auto starts = std::vector<size_t>() ;
+    auto total = size_t(0) ;
+    for (const auto &path:paths){
+        tables.push_back(path.string());
+    }
+    for (const auto &storage:storages){
+        starts.push_back(total);
+        total += storage.size() ;
+    }
+    struct partial_t {
+        std::uint64_t blanks = 0 ;
+        std::vector<std::uint64_t> histogram = std::vector<std::uint64_t>(32768,0) ;
+        std::array<std::uint64_t,bandcount> bands{} ;
+        std::vector<entrystats_t> entries ;
+    };
+    auto partials = std::vector<partial_t>(parallel::threads(total)) ;
+    parallel::forEach(total, [&starts,&storages,&partials](size_t first,size_t last,size_t chunk){
+        auto &partial = partials[chunk] ;
+        auto table = static_cast<size_t>(std::upper_bound(starts.begin(),starts.end(),first) - starts.begin()) - 1 ;
+        auto luminance = std::array<float,32>() ;
+        for (auto index = first ; index<last;index++){
+            while (index - starts[table] >= storages[table].size()){
+                table++ ;
+            }
+            auto id = static_cast<std::uint32_t>(index - starts[table]) ;
+            const auto &entry = std::as_const(storages[table])[id] ;
+            if (entry.empty()){
+                partial.blanks++ ;
+                continue;
+            }
+            auto stats = entrystats_t{static_cast<std::uint32_t>(table),id,1.0f,0.0f,1.0f,flatshape} ;
+            for (auto j = 0 ; j<32;j++){
+                auto color = static_cast<std::uint16_t>(entry[j].color & 0x7fff) ;
+                partial.histogram[color]++ ;
+                luminance[j] = colorspace::luminance(color) ;
+                partial.bands[std::min(bandcount-1,static_cast<int>(luminance[j]*bandcount))]++ ;
+                stats.minimum = std::min(stats.minimum,luminance[j]) ;
+                stats.maximum = std::max(stats.maximum,luminance[j]) ;
+            }
+            stats.contrast = (stats.maximum + 0.05f)/(stats.minimum + 0.05f) ;
+            auto range = stats.maximum - stats.minimum ;
+            if (range > 0.001f){
+                stats.shape = 0 ;
+                for (auto quarter = 0 ; quarter<4;quarter++){
+                    auto sum = 0.0f ;
+                    for (auto j = quarter*8 ; j<(quarter+1)*8;j++){
+                        sum += (luminance[j] - stats.minimum)/range ;
+                    }
+                    auto level = std::min(3,static_cast<int>((sum/8.0f)*4.0f)) ;
+                    stats.shape = static_cast<std::uint16_t>((stats.shape<<2) | level) ;
+                }
+            }
+            partial.entries.push_back(stats);
+        }
+    });
+    for (const auto &partial:partials){
+        blanks += partial.blanks ;
+        for (size_t j = 0 ; j<histogram.size();j++){
+            histogram[j] += partial.histogram[j] ;
+        }
+        for (size_t j = 0 ; j<bands.size();j++){
+            bands[j] += partial.bands[j] ;
+        }
+        entries.insert(entries.end(),partial.entries.begin(),partial.entries.end());
+    }
+}
+//=======================================================================================================================
+auto huestats_t::shapeName(std::uint16_t shape) ->std::string {
+    if (shape == flatshape){
+        return "flat"s ;
+    }
+    auto rvalue = std::string(4,'0') ;
+    for (auto j = 0 ; j<4;j++){
+        rvalue[3-j] = static_cast<char>('0' + ((shape>>(j*2))&3)) ;
+    }
+    return rvalue ;
+}
+//=======================================================================================================================
+// The ramp shape clusters, with the number of entries in each, largest first
+auto huestats_t::shapes() const ->std::vector<std::pair<std::uint16_t,std::uint64_t>> {
+    auto counts = std::map<std::uint16_t,std::uint64_t>() ;
+    for (const auto &entry:entries){
+        counts[entry.shape]++ ;
+    }
+    auto rvalue = std::vector<std::pair<std::uint16_t,std::uint64_t>>(counts.begin(),counts.end()) ;
+    std::stable_sort(rvalue.begin(),rvalue.end(),[](const auto &lhs,const auto &rhs){
+        return lhs.second > rhs.second ;
+    });
+    return rvalue ;
+}
+//=======================================================================================================================
+auto huestats_t::writeJSON(std::ostream &output) const ->void {
+    output <<std::fixed<<std::setprecision(4) ;
+    output <<"{\n  \"tables\": [" ;
+    for (size_t j = 0 ; j<tables.size();j++){
+        output <<(j==0?"":", ")<<"\""<<strutil::escapeJSON(tables[j])<<"\"" ;
+    }
+    output <<"],\n  \"entries\": "<<entries.size()<<",\n  \"blank\": "<<blanks<<",\n" ;
+    output <<"  \"histogram\": [" ;
+    auto first = true ;
+    for (size_t j = 0 ; j<histogram.size();j++){
+        if (histogram[j] != 0){
+            output <<(first?"\n":",\n")<<"    {\"color\": \""<<huecolor_t(static_cast<std::uint16_t>(j)).description()<<"\", \"count\": "<<histogram[j]<<"}" ;
+            first = false ;
+        }
+    }
+    output <<"\n  ],\n  \"bands\": [" ;
+    for (size_t j = 0 ; j<bands.size();j++){
+        output <<(j==0?"\n":",\n")<<"    {\"low\": "<<static_cast<float>(j)/bandcount<<", \"high\": "<<static_cast<float>(j+1)/bandcount<<", \"count\": "<<bands[j]<<"}" ;
+    }
+    output <<"\n  ],\n  \"shapes\": [" ;
+    first = true ;
+    for (const auto &[shape,count]:shapes()){
+        output <<(first?"\n":",\n")<<"    {\"shape\": \""<<shapeName(shape)<<"\", \"count\": "<<count<<"}" ;
+        first = false ;
+    }
+    output <<"\n  ],\n  \"ramps\": [" ;
+    first = true ;
+    for (const auto &entry:entries){
+        output <<(first?"\n":",\n")<<"    {\"table\": "<<entry.table<<", \"id\": "<<entry.id<<", \"min\": "<<entry.minimum<<", \"max\": "<<entry.maximum<<", \"contrast\": "<<entry.contrast<<", \"shape\": \""<<shapeName(entry.shape)<<"\"}" ;
+        first = false ;
+    }
+    output <<"\n  ]\n}"<<std::endl;
+}
+//=======================================================================================================================
+// Each section is its own csv table, separated by a blank line
+auto huestats_t::writeCSV(std::ostream &output) const ->void {
+    output <<std::fixed<<std::setprecision(4) ;
+    output <<"table,path\n" ;
+    for (size_t j = 0 ; j<tables.size();j++){
+        output <<j<<","<<strutil::quoteCSV(tables[j])<<"\n" ;
+    }
+    output <<"\ncolor,count\n" ;
+    for (size_t j = 0 ; j<histogram.size();j++){
+        if (histogram[j] != 0){
+            output <<huecolor_t(static_cast<std::uint16_t>(j)).description()<<","<<histogram[j]<<"\n" ;
+        }
+    }
+    output <<"\nlow,high,count\n" ;
+    for (size_t j = 0 ; j<bands.size();j++){
+        output <<static_cast<float>(j)/bandcount<<","<<static_cast<float>(j+1)/bandcount<<","<<bands[j]<<"\n" ;
+    }
+    output <<"\nshape,count\n" ;
+    for (const auto &[shape,count]:shapes()){
+        output <<shapeName(shape)<<","<<count<<"\n" ;
+    }
+    output <<"\ntable,id,min,max,contrast,shape\n" ;
+    for (const auto &entry:entries){
+        output <<entry.table<<","<<entry.id<<","<<entry.minimum<<","<<entry.maximum<<","<<entry.contrast<<","<<shapeName(entry.shape)<<"\n" ;
+    }
+    output.flush();
+}
@@ -0,0 +1,48 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#ifndef huestats_hpp
+#define huestats_hpp
+
+#include <cstdint>
+#include <string>
+#include <array>
+#include <vector>
+#include <ostream>
+#include <filesystem>
+
+#include "huedata.hpp"
+
+//=======================================================================================================================
+// huestats_t  Palette statistics over one or more hue tables (blank entries are not counted).
+// histogram counts every rgb555 value used, bands counts the colors by relative luminance (eight
+// equal bands), and every entry gets its luminance range, contrast ratio and ramp shape.
+// The shape of a ramp is its normalized luminance averaged over four quarters of the ramp, each
+// quantized to 0-3, so "0123" is a steady climb, "3210" a descent, and "flat" has no range at all.
+//=======================================================================================================================
+struct huestats_t {
+    struct entrystats_t {
+        std::uint32_t table ;
+        std::uint32_t id ;
+        float minimum ;
+        float maximum ;
+        float contrast ;
+        std::uint16_t shape ;
+    };
+    static constexpr auto flatshape = std::uint16_t(0x100) ;
+    static constexpr auto bandcount = 8 ;
+
+    std::vector<std::string> tables ;
+    std::uint64_t blanks ;
+    std::vector<std::uint64_t> histogram ;
+    std::array<std::uint64_t,bandcount> bands ;
+    std::vector<entrystats_t> entries ;
+    
+    huestats_t(const std::vector<std::filesystem::path> &paths,std::uint32_t maxnum=3000) ;
+    
+    static auto shapeName(std::uint16_t shape) ->std::string ;
+    auto shapes() const ->std::vector<std::pair<std::uint16_t,std::uint64_t>> ;
+    auto writeJSON(std::ostream &output) const ->void ;
+    auto writeCSV(std::ostream &output) const ->void ;
+};
+
+#endif /* huestats_hpp */
@@ -0,0 +1,144 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#include "huewatch.hpp"
+
+#include <iostream>
+#include <stdexcept>
+#include <fstream>
+#include <chrono>
+#include <thread>
+#include <system_error>
+#include <tuple>
+#include <utility>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "huejournal.hpp"
+
+using namespace std::string_literals;
+
+//=======================================================================================================================
+// huewatch_t
+//=======================================================================================================================
+
+//=======================================================================================================================
+huewatch_t::huewatch_t(const std::filesystem::path &huemul,const std::filesystem::path &csv,std::uint32_t maxnum):huepath(huemul),csvpath(csv),huemax(maxnum),snapshot(maxnum){
+    snapshot.load(huepath);
+    rows.reserve(snapshot.size());
+    for (size_t j = 0 ; j<snapshot.size();j++){
+        rows.push_back(std::to_string(j)+","s+std::as_const(snapshot)[static_cast<std::uint32_t>(j)].description());
+    }
+    writeText();
+}
+//=======================================================================================================================
+// The csv is written to a temporary and renamed over the old one, so readers never see a partial file
+auto huewatch_t::writeText() const ->void {
+    auto temppath = csvpath ;
+    temppath += ".tmp" ;
+    {
+        auto output = std::ofstream(temppath.string());
+        if (!output.is_open()){
+            throw std::runtime_error("Unable to create: "s+temppath.string());
+        }
+        output << huestorage_t::text_header<<"\n" ;
+        for (const auto &row:rows){
+            output << row <<"\n";
+        }
+    }
+    std::filesystem::rename(temppath, csvpath);
+}
+//=======================================================================================================================
+// Reload the hue mul, and rewrite the rows that changed. Returns the ids that changed
+auto huewatch_t::refresh() ->std::vector<std::uint32_t> {
+    auto current = huestorage_t(huepath,huemax) ;
+    auto changes = snapshot.changed(current) ;
+    if (!changes.empty()){
+        rows.resize(current.size());
+        for (const auto &id:changes){
+            if (id < current.size()){
+                rows[id] = std::to_string(id)+","s+std::as_const(current)[id].description() ;
+            }
+        }
+        snapshot = std::move(current) ;
+        writeText();
+    }
+    return changes ;
+}
+//=======================================================================================================================
+// Runs until the process is terminated. On linux, inotify is used on the directory containing the
+// hue mul (so tools that write a temporary and rename it are caught). Elsewhere the file is polled.
+// Either way the journal of the mul is watched too, as journaled edits leave the mul untouched.
+auto huewatch_t::run() ->void {
+    auto report = [this](){
+        try {
+            auto changes = refresh() ;
+            for (const auto &id:changes){
+                std::cout <<(id < snapshot.size() ? "changed ":"removed ")<<id<<"\n";
+            }
+            std::cout.flush();
+        }
+        catch (const std::exception &e){
+            // The file may be in the middle of being written, we will catch it on the next change
+            std::cerr <<e.what()<<std::endl;
+        }
+    };
+#if defined(__linux__)
+    auto directory = std::filesystem::absolute(huepath).parent_path() ;
+    auto filename = huepath.filename().string() ;
+    auto journalname = huejournal_t::path(huepath).filename().string() ;
+    auto fd = inotify_init();
+    if (fd < 0){
+        throw std::runtime_error("Unable to initialize inotify");
+    }
+    if (inotify_add_watch(fd, directory.string().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE) < 0){
+        close(fd);
+        throw std::runtime_error("Unable to watch: "s + directory.string());
+    }
+    auto buffer = std::vector<char>(4096 + sizeof(inotify_event) + 256,0) ;
+    while (true){
+        auto amount = read(fd, buffer.data(), buffer.size()) ;
+        if (amount <= 0){
+            break;
+        }
+        auto relevant = false ;
+        for (auto offset = ssize_t(0) ; offset < amount;) {
+            auto event = reinterpret_cast<const inotify_event*>(buffer.data()+offset) ;
+            if ((event->len > 0) && (filename == event->name) && ((event->mask & IN_DELETE) == 0)){
+                relevant = true ;
+            }
+            else if ((event->len > 0) && (journalname == event->name)){
+                relevant = true ;
+            }
+            offset += sizeof(inotify_event) + event->len ;
+        }
+        if (relevant){
+            report();
+        }
+    }
+    close(fd);
+#else
+    // The size and write time of the mul and its journal (a missing journal being a size of 0)
+    auto journalpath = huejournal_t::path(huepath) ;
+    auto state = [this,&journalpath](std::error_code &ec){
+        auto stamp = std::filesystem::last_write_time(huepath,ec) ;
+        auto length = ec ? std::uintmax_t(0) : std::filesystem::file_size(huepath,ec) ;
+        auto journalec = std::error_code() ;
+        auto journalstamp = std::filesystem::last_write_time(journalpath,journalec) ;
+        auto journallength = journalec ? std::uintmax_t(0) : std::filesystem::file_size(journalpath,journalec) ;
+        return std::make_tuple(stamp,length,journalstamp,journallength) ;
+    };
+    auto ec = std::error_code() ;
+    auto current = state(ec) ;
+    while (true){
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        auto now = state(ec) ;
+        if (!ec && (now != current)){
+            current = now ;
+            report();
+        }
+    }
+#endif
+}
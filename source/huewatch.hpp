@@ -0,0 +1,32 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#ifndef huewatch_hpp
+#define huewatch_hpp
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#include "huedata.hpp"
+
+//=======================================================================================================================
+// huewatch_t  Keeps a csv export current with a hue mul that is edited by other tools.
+// Each refresh diffs the new records against the previous snapshot, and only the changed
+// rows are formatted again. The changed ids are reported as a change stream.
+//=======================================================================================================================
+class huewatch_t {
+    std::filesystem::path huepath ;
+    std::filesystem::path csvpath ;
+    std::uint32_t huemax ;
+    huestorage_t snapshot ;
+    std::vector<std::string> rows ;
+
+    auto writeText() const ->void ;
+public:
+    huewatch_t(const std::filesystem::path &huemul,const std::filesystem::path &csv,std::uint32_t maxnum=3000) ;
+    auto refresh() ->std::vector<std::uint32_t> ;
+    auto run() ->void ;
+};
+
+#endif /* huewatch_hpp */
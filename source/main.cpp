@@ -1,63 +1,74 @@
 //Copyright © 2022 Charles Kerr. All rights reserved.
 
 #include <iostream>
+#include <fstream>
 #include <stdexcept>
 #include <string>
 #include <cstdint>
 #include <cstdlib>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "argument.hpp"
 #include "strutil.hpp"
 #include "huedata.hpp"
+#include "huewatch.hpp"
+#include "huecolumn.hpp"
+#include "huestats.hpp"
+#include "huesort.hpp"
+#include "huesplice.hpp"
+#include "huefind.hpp"
+#include "huelayer.hpp"
+#include "huearchive.hpp"
+#include "huecatalog.hpp"
+#include "huerender.hpp"
+#include "huejournal.hpp"
+#include "huefit.hpp"
+#include "huequery.hpp"
 
 using namespace std::string_literals;
 
-
 //================================================================================
-auto determine_ids(const std::string& list) ->std::vector<std::uint32_t> {
-    auto rvalue = std::vector<std::uint32_t>() ;
-    auto values = strutil::parse(list,",") ;
-    for (const auto &entry:values){
-        auto [first,last] = strutil::split(entry,"-") ;
-        if (last.empty()){
-            last = first ;
-        }
-        
-        if (!first.empty()){
-            auto start = strutil::ston<std::uint32_t>(first);
-            auto finish = strutil::ston<std::uint32_t>(last);
-            for (std::uint32_t j=start; j<=finish;j++){
-                rvalue.push_back(j);
-            }
-        }
+// Reports a created file, unless it was written to stdout
+auto reportCreated(const std::filesystem::path &path) ->void {
+    if (!isStdio(path)){
+        std::cout <<path.string() <<" created"<<std::endl;
     }
-    return rvalue ;
 }
 
 //================================================================================
 int main(int argc, const char * argv[]) {
     enum class action_t{
-        merge,extract,empty,compare,create,help
+        merge,extract,empty,compare,create,watch,update,columnar,statspalette,sort,split,splice,find,patch,flatten,pack,unpack,ingest,where,render,edit,checkpoint,fit,select,help
     };
     const std::unordered_map<std::string,action_t> keys{
         {"merge"s,action_t::merge},{"extract"s,action_t::extract},
         {"empty"s,action_t::empty},{"compare"s,action_t::compare},
-        {"create"s,action_t::create},{"help"s,action_t::help},
+        {"create"s,action_t::create},{"watch"s,action_t::watch},
+        {"update"s,action_t::update},{"columnar"s,action_t::columnar},
+        {"stats-palette"s,action_t::statspalette},{"sort"s,action_t::sort},
+        {"split"s,action_t::split},{"splice"s,action_t::splice},
+        {"find"s,action_t::find},{"patch"s,action_t::patch},{"flatten"s,action_t::flatten},
+        {"pack"s,action_t::pack},{"unpack"s,action_t::unpack},
+        {"ingest"s,action_t::ingest},{"where"s,action_t::where},
+        {"render"s,action_t::render},{"edit"s,action_t::edit},{"checkpoint"s,action_t::checkpoint},
+        {"fit"s,action_t::fit},{"select"s,action_t::select},
+        {"help"s,action_t::help},
     };
-    auto ids = std::vector<std::uint32_t>() ;
     auto action = action_t::help ;
+    auto actionvalue = std::string() ;
     auto rvalue = EXIT_SUCCESS ;
     auto maxhue = std::uint32_t(3000) ;
+    auto format = std::string() ;
     try {
         auto arg = argument_t(argc,argv) ;
         for (const auto &[key,value]:arg.flags){
             if (key=="maxhue"){
-                maxhue = strutil::ston<std::uint32_t>(value) ;
-                if (maxhue%8 != 0) {
-                    maxhue += (8 - (maxhue%8)) ;
-                }
+                maxhue = static_cast<std::uint32_t>(stock_format::roundUp(strutil::ston<std::uint32_t>(value))) ;
+            }
+            else if (key=="format"){
+                format = strutil::lower(value) ;
             }
             else {
                 auto iter = keys.find(key) ;
@@ -66,7 +77,7 @@ int main(int argc, const char * argv[]) {
                         throw std::runtime_error("Conflicting action flags");
                     }
                     action = iter->second ;
-                    ids = determine_ids(value) ;
+                    actionvalue = value ;
                 }
             }
         }
@@ -91,7 +102,101 @@ int main(int argc, const char * argv[]) {
                 std::cout <<"\thueedit --create huemul huecvsfile\n";
                 std::cout <<"\t\tCreates a huemul from the cvs file.\n";
                 std::cout <<"\n" ;
+                std::cout <<"\thueedit --watch huemulsrc huecsvfile\n";
+                std::cout <<"\t\tExtracts huemulsrc to the csv file, and then keeps the csv file current as huemulsrc\n";
+                std::cout <<"\t\tis changed by other tools. Only changed rows are regenerated, and the changed ids\n";
+                std::cout <<"\t\tare printed as they are detected.\n";
+                std::cout <<"\n" ;
+                std::cout <<"\thueedit --update huemul huecsvfile\n";
+                std::cout <<"\t\tUpdates huemul in place from the csv file. Only the rows that differ from huemul\n";
+                std::cout <<"\t\tare parsed and written, and the changed ids are printed.\n";
+                std::cout <<"\n" ;
+                std::cout <<"\thueedit --columnar huemulsrc columnfile\n";
+                std::cout <<"\t\tWrites the entries as binary columns (an npy style header followed by one array\n";
+                std::cout <<"\t\tper column): blank, color (rgb555), rgb888, linear rgb and CIELAB. A columnfile\n";
+                std::cout <<"\t\tof - writes the columns to stdout.\n";
+                std::cout <<"\n" ;
+                std::cout <<"\thueedit --stats-palette[=json|csv] huemul ...\n";
+                std::cout <<"\t\tPrints palette statistics over all the hue muls: a histogram of the rgb555 colors\n";
+                std::cout <<"\t\tused, color counts by luminance band, ramp shape clusters, and the luminance\n";
+                std::cout <<"\t\trange and contrast of each entry. The default format is json.\n";
+                std::cout <<"\n" ;
+                std::cout <<"\thueedit --sort=hue|luminance|similarity huemulsrc huemuldest [remapcsv]\n";
+                std::cout <<"\t\tReorders the non blank entries (other than id 0) of huemulsrc, within the ids they\n";
+                std::cout <<"\t\toccupy, and saves to huemuldest. The old to new id remap is written to remapcsv,\n";
+                std::cout <<"\t\tor printed if not given.\n";
+                std::cout <<"\n" ;
+                std::cout <<"\thueedit --split=ranges huemulsrc directory\n";
+                std::cout <<"\t\tWrites each id range (for example 0-2999,3000-) of huemulsrc to its own hue mul in\n";
+                std::cout <<"\t\tdirectory, with the ids renumbered from 0. A range of a- runs to the last entry.\n";
+                std::cout <<"\n" ;
+                std::cout <<"\thueedit --splice huemulbase huemulpart@offset ... huemuldest\n";
+                std::cout <<"\t\tLays each part over huemulbase, starting at the id offset (later parts win), and\n";
+                std::cout <<"\t\tsaves to huemuldest. Aligned groups are copied without being decoded.\n";
+                std::cout <<"\n" ;
+                std::cout <<"\thueedit --find=pattern huemul\n";
+                std::cout <<"\t\tPrints the id and name of every entry whose name matches pattern, ignoring case.\n";
+                std::cout <<"\t\t* matches any run of characters and ? any one, so ice* finds names starting\n";
+                std::cout <<"\t\twith ice, and *dye* names containing dye.\n";
+                std::cout <<"\n" ;
+                std::cout <<"\thueedit --patch huemulbase huemuledited patchfile\n";
+                std::cout <<"\t\tWrites the entries of huemuledited that differ from huemulbase to a sparse patch,\n";
+                std::cout <<"\t\twith the size of huemuledited (so flattening can shrink the table as well).\n";
+                std::cout <<"\n" ;
+                std::cout <<"\thueedit --flatten huemulbase patchfile ... huemuldest\n";
+                std::cout <<"\t\tStacks the patches over huemulbase in order (later patches win), and saves the\n";
+                std::cout <<"\t\tresult to huemuldest.\n";
+                std::cout <<"\n" ;
+                std::cout <<"\thueedit --pack huemul huezfile\n";
+                std::cout <<"\t\tCompresses huemul to a .huez archive, which unpacks to the same bytes.\n";
+                std::cout <<"\n" ;
+                std::cout <<"\thueedit --unpack huezfile huemul\n";
+                std::cout <<"\t\tRestores the hue mul from a .huez archive.\n";
+                std::cout <<"\n" ;
+                std::cout <<"\thueedit --ingest catalog huemul ...\n";
+                std::cout <<"\t\tAdds the hue muls to the catalog (created if needed) of where each ramp occurs.\n";
+                std::cout <<"\t\tMuls already in the catalog are only read again if they have changed.\n";
+                std::cout <<"\n" ;
+                std::cout <<"\thueedit --where=ids catalog huemul\n";
+                std::cout <<"\t\tFor each id (for example 1,5,10-20) of huemul, prints every other file, id and name\n";
+                std::cout <<"\t\tin the catalog with the same ramp. A catalogued huemul is not read.\n";
+                std::cout <<"\n" ;
+                std::cout <<"\thueedit --render huemul [huemul2] imagefile\n";
+                std::cout <<"\t\tDraws every entry as a row of 32 swatches, labeled with its id, to a ppm or png\n";
+                std::cout <<"\t\tcontact sheet. Blank entries are checkered. With two hue muls, their ramps are\n";
+                std::cout <<"\t\tdrawn side by side, and the ids of the entries that differ are red.\n";
+                std::cout <<"\n" ;
+                std::cout <<"\thueedit --edit=set|clear|rename|append huemul [id] [value]\n";
+                std::cout <<"\thueedit --edit huemul [editfile]\n";
+                std::cout <<"\t\tRecords edits in the journal beside huemul (huemul.journal), instead of rewriting it.\n";
+                std::cout <<"\t\tset takes an id and name,r:g:b,... (32 colors), clear an id, rename an id and name,\n";
+                std::cout <<"\t\tand append name,r:g:b,... With no edit given, each line of editfile (or stdin) is an\n";
+                std::cout <<"\t\tedit such as set,12,name,r:g:b,... The journal is applied whenever huemul is read.\n";
+                std::cout <<"\n" ;
+                std::cout <<"\thueedit --checkpoint huemul\n";
+                std::cout <<"\t\tFolds the journal into huemul, and removes the journal.\n";
+                std::cout <<"\n" ;
+                std::cout <<"\thueedit --fit[=name] huemul image.ppm|directory ...\n";
+                std::cout <<"\t\tFits a 32 step ramp to the colors of each image (dark to light), and puts it in\n";
+                std::cout <<"\t\tthe first blank id of huemul (other than 0), or appends it. The hue is named by\n";
+                std::cout <<"\t\tname if given (for a single image), otherwise by the image file name. A directory\n";
+                std::cout <<"\t\tfits every ppm in it, the images spread over the threads. If huemul has a journal\n";
+                std::cout <<"\t\t(from --edit), the fitted hues are added to it, otherwise they are saved to huemul.\n";
+                std::cout <<"\n" ;
+                std::cout <<"\thueedit --select=expression [--format=ids|csv|json] huemul\n";
+                std::cout <<"\t\tPrints the entries that match the expression, as ids (the default), csv rows or\n";
+                std::cout <<"\t\tjson. Predicates are blank, id=1,5,10-20, name~pattern (as --find), has=r:g:b,\n";
+                std::cout <<"\t\tand field.min or field.max compared (< <= > >= = !=) with a value, where field\n";
+                std::cout <<"\t\tis red, green, blue, bright (largest channel) or lum (luminance 0-1). They are\n";
+                std::cout <<"\t\tcombined with and, or, not and parentheses, for example:\n";
+                std::cout <<"\t\t\t--select=\"not blank and bright.max<8 and name~*shadow*\"\n";
+                std::cout <<"\n" ;
                 std::cout <<"Note:\n";
+                std::cout <<"\t A path of - reads from stdin, or writes to stdout. Extracting, and creating from a\n";
+                std::cout <<"\t piped csv (which must be in id order), are converted one group at a time.\n";
+                std::cout <<"\n";
+                std::cout <<"\t Any hue mul path ending in .huez is read and written as a compressed archive.\n";
+                std::cout <<"\n";
                 std::cout <<"\t The color channels in the csv range from 0-31 (5 bit channels)\n";
                 std::cout <<"\n";
                 std::cout <<"\t--maxhue=# allows one to create hue files greater then 3000 entries.\n";
@@ -108,7 +213,7 @@ int main(int argc, const char * argv[]) {
                 auto addition = huestorage_t(arg.paths[1],maxhue) ;
                 base.merge(addition);
                 base.save(arg.paths[2]) ;
-                std::cout <<arg.paths[2].string() <<" created"<<std::endl;
+                reportCreated(arg.paths[2]);
 
                 break;
             }
@@ -116,9 +221,8 @@ int main(int argc, const char * argv[]) {
                 if (arg.paths.size()<2) {
                     throw std::runtime_error("Hue mul path and CSV path required.");
                 }
-                auto hue = huestorage_t(arg.paths[0],maxhue);
-                hue.exportText(arg.paths[1]);
-                std::cout <<arg.paths[1].string() <<" created"<<std::endl;
+                huestorage_t::streamText(arg.paths[0],arg.paths[1],maxhue);
+                reportCreated(arg.paths[1]);
                break;
             }
             case action_t::empty:{
@@ -151,13 +255,321 @@ int main(int argc, const char * argv[]) {
                 if (arg.paths.size()<2) {
                     throw std::runtime_error("Hue mul path and CSV path required.");
                 }
-                auto hues = huestorage_t(maxhue) ;
-                hues.importText(arg.paths[1]);
-                if (hues.size()==0){
-                    throw std::runtime_error("No hues where created from "s+arg.paths[1].filename().string());
+                if (isStdio(arg.paths[1])){
+                    // Piped csv is converted as it arrives, so it must be in id order
+                    huestorage_t::streamMul(arg.paths[1],arg.paths[0],maxhue);
+                }
+                else {
+                    auto hues = huestorage_t(maxhue) ;
+                    hues.importText(arg.paths[1]);
+                    if (hues.size()==0){
+                        throw std::runtime_error("No hues where created from "s+arg.paths[1].filename().string());
+                    }
+                    hues.save(arg.paths[0]);
+                }
+                reportCreated(arg.paths[0]);
+                break;
+            }
+            case action_t::watch:{
+                if (arg.paths.size()<2) {
+                    throw std::runtime_error("Hue mul path and CSV path required.");
+                }
+                auto watch = huewatch_t(arg.paths[0],arg.paths[1],maxhue) ;
+                std::cout <<"Watching "<<arg.paths[0].string() <<" for changes"<<std::endl;
+                watch.run() ;
+                break;
+            }
+            case action_t::update:{
+                if (arg.paths.size()<2) {
+                    throw std::runtime_error("Hue mul path and CSV path required.");
+                }
+                auto hues = huestorage_t(arg.paths[0],maxhue) ;
+                auto changed = hues.updateText(arg.paths[1]) ;
+                if (!changed.empty()){
+                    hues.save(arg.paths[0],changed) ;
+                }
+                std::cout <<"Changed ids in "<<arg.paths[0].filename().string()<<": "<<changed.size()<<"\n";
+                for (const auto &id:changed){
+                    std::cout <<"\t"<<id<<std::endl;
+                }
+                break;
+            }
+            case action_t::columnar:{
+                if (arg.paths.size()<2) {
+                    throw std::runtime_error("Hue mul path and column file path required.");
+                }
+                auto hues = huestorage_t(arg.paths[0],maxhue) ;
+                auto columns = huecolumns_t(hues) ;
+                columns.save(arg.paths[1]) ;
+                reportCreated(arg.paths[1]);
+                break;
+            }
+            case action_t::statspalette:{
+                if (arg.paths.empty()){
+                    throw std::runtime_error("No hue mul file specified");
+                }
+                auto format = strutil::lower(actionvalue) ;
+                if (!format.empty() && (format != "json") && (format != "csv")){
+                    throw std::runtime_error("Unknown stats format: "s + actionvalue);
+                }
+                auto stats = huestats_t(arg.paths,maxhue) ;
+                if (format == "csv"){
+                    stats.writeCSV(std::cout);
+                }
+                else {
+                    stats.writeJSON(std::cout);
+                }
+                break;
+            }
+            case action_t::sort:{
+                if (arg.paths.size()<2) {
+                    throw std::runtime_error("Src hue mul path and Destination mul path required.");
+                }
+                auto key = sortKey(actionvalue) ;
+                auto hues = huestorage_t(arg.paths[0],maxhue) ;
+                auto remap = sortHues(hues,key) ;
+                hues.save(arg.paths[1]);
+                auto output = std::ofstream() ;
+                if (arg.paths.size()>2){
+                    output.open(arg.paths[2].string());
+                    if (!output.is_open()){
+                        throw std::runtime_error("Unable to create: "s + arg.paths[2].string());
+                    }
+                }
+                // The remap can't share stdout with the hue mul
+                auto &remapout = arg.paths.size()>2 ? static_cast<std::ostream&>(output) : (isStdio(arg.paths[1]) ? std::cerr : std::cout) ;
+                remapout <<"oldid,newid\n";
+                for (const auto &[oldid,newid]:remap){
+                    remapout <<oldid<<","<<newid<<"\n";
+                }
+                remapout.flush();
+                if (arg.paths.size()>2){
+                    reportCreated(arg.paths[1]);
+                    reportCreated(arg.paths[2]);
+                }
+                break;
+            }
+            case action_t::find:{
+                if (arg.paths.empty()){
+                    throw std::runtime_error("No hue mul file specified");
+                }
+                auto hues = huestorage_t(arg.paths[0],maxhue) ;
+                auto index = hueindex_t(hues) ;
+                for (const auto &id:index.find(actionvalue)){
+                    std::cout <<id<<","<<std::as_const(hues)[id].name()<<"\n";
+                }
+                break;
+            }
+            case action_t::patch:{
+                if (arg.paths.size()<3) {
+                    throw std::runtime_error("Base hue mul path, Edited hue mul path and Patch path required.");
+                }
+                auto base = huestorage_t(arg.paths[0],maxhue) ;
+                auto edited = huestorage_t(arg.paths[1],maxhue) ;
+                auto patch = huepatch_t(base,edited) ;
+                patch.save(arg.paths[2]);
+                std::cout <<arg.paths[2].string()<< " created with "<<patch.records.size()<<" entries"<<std::endl;
+                break;
+            }
+            case action_t::flatten:{
+                if (arg.paths.size()<2) {
+                    throw std::runtime_error("Base hue mul path and Destination mul path required.");
+                }
+                auto overlay = hueoverlay_t(arg.paths[0],maxhue) ;
+                for (size_t j = 1 ; j+1<arg.paths.size();j++){
+                    overlay.push(arg.paths[j]);
+                }
+                overlay.flatten().save(arg.paths.back());
+                reportCreated(arg.paths.back());
+                break;
+            }
+            case action_t::pack:{
+                if (arg.paths.size()<2) {
+                    throw std::runtime_error("Hue mul path and Archive path required.");
+                }
+                packMul(arg.paths[0],arg.paths[1]);
+                std::cout <<arg.paths[1].string()<< " created ("<<std::filesystem::file_size(arg.paths[0])<<" to "<<std::filesystem::file_size(arg.paths[1])<<" bytes)"<<std::endl;
+                break;
+            }
+            case action_t::unpack:{
+                if (arg.paths.size()<2) {
+                    throw std::runtime_error("Archive path and Hue mul path required.");
+                }
+                unpackMul(arg.paths[0],arg.paths[1]);
+                reportCreated(arg.paths[1]);
+                break;
+            }
+            case action_t::ingest:{
+                if (arg.paths.size()<2) {
+                    throw std::runtime_error("Catalog path and Hue mul path(s) required.");
+                }
+                auto catalog = huecatalog_t() ;
+                if (std::filesystem::exists(arg.paths[0])){
+                    catalog.load(arg.paths[0]);
+                }
+                auto huepaths = std::vector<std::filesystem::path>(arg.paths.begin()+1,arg.paths.end()) ;
+                auto added = catalog.ingest(huepaths,maxhue) ;
+                for (size_t j = 0 ; j<huepaths.size();j++){
+                    std::cout <<huepaths[j].string()<<": "<<added[j]<<" entries added"<<std::endl;
+                }
+                catalog.save(arg.paths[0]);
+                break;
+            }
+            case action_t::where:{
+                if (arg.paths.size()<2) {
+                    throw std::runtime_error("Catalog path and Hue mul path required.");
+                }
+                auto catalog = huecatalog_t(arg.paths[0]) ;
+                auto ids = determine_ids(actionvalue) ;
+                auto file = catalog.find(arg.paths[1]) ;
+                auto hashes = std::vector<std::uint64_t>() ;
+                if (file == std::string::npos){
+                    const auto hues = huestorage_t(arg.paths[1],maxhue) ;
+                    for (const auto &id:ids){
+                        hashes.push_back((id < hues.size()) && !hues[id].empty() ? hues[id].hash(false) : 0);
+                    }
+                }
+                else {
+                    for (const auto &id:ids){
+                        hashes.push_back(catalog.hash(static_cast<std::uint32_t>(file),id));
+                    }
+                }
+                std::cout <<"hueid,file,id,name\n";
+                for (size_t j = 0 ; j<ids.size();j++){
+                    if (hashes[j] == 0){
+                        continue;
+                    }
+                    for (const auto &entry:catalog.lookup(hashes[j])){
+                        if ((entry.file != file) || (entry.id != ids[j])){
+                            std::cout <<ids[j]<<","<<catalog.file(entry.file).path<<","<<entry.id<<","<<entry.name<<"\n";
+                        }
+                    }
+                }
+                break;
+            }
+            case action_t::render:{
+                if (arg.paths.size()<2) {
+                    throw std::runtime_error("Hue mul path(s) and Image path required.");
+                }
+                auto hues = huestorage_t(arg.paths[0],maxhue) ;
+                if (arg.paths.size()>2){
+                    renderDiff(hues,huestorage_t(arg.paths[1],maxhue),arg.paths.back());
+                }
+                else {
+                    renderSheet(hues,arg.paths.back());
+                }
+                reportCreated(arg.paths.back());
+                break;
+            }
+            case action_t::edit:{
+                if (arg.paths.empty()){
+                    throw std::runtime_error("No hue mul file specified");
+                }
+                auto journal = huejournal_t(arg.paths[0],maxhue) ;
+                if (!actionvalue.empty()){
+                    auto line = actionvalue ;
+                    for (size_t j = 1 ; j<arg.paths.size();j++){
+                        line += ","s + arg.paths[j].string() ;
+                    }
+                    journal.edit(line);
+                }
+                else {
+                    auto input = std::ifstream() ;
+                    if ((arg.paths.size()>1) && !isStdio(arg.paths[1])){
+                        input.open(arg.paths[1].string());
+                        if (!input.is_open()){
+                            throw std::runtime_error("Unable to open: "s + arg.paths[1].string());
+                        }
+                    }
+                    auto &source = input.is_open() ? static_cast<std::istream&>(input) : std::cin ;
+                    auto line = std::string() ;
+                    while (std::getline(source,line)){
+                        if (!strutil::trim(line).empty()){
+                            journal.edit(line);
+                        }
+                    }
+                }
+                journal.commit();
+                break;
+            }
+            case action_t::checkpoint:{
+                if (arg.paths.empty()){
+                    throw std::runtime_error("No hue mul file specified");
+                }
+                std::cout <<huejournal_t::checkpoint(arg.paths[0],maxhue)<<" edits checkpointed into "<<arg.paths[0].string()<<std::endl;
+                break;
+            }
+            case action_t::fit:{
+                if (arg.paths.size()<2) {
+                    throw std::runtime_error("Hue mul path and Image path(s) required.");
+                }
+                if (!std::filesystem::exists(arg.paths[0])){
+                    throw std::runtime_error("Does not exist: "s + arg.paths[0].string());
+                }
+                auto fitted = std::vector<std::pair<std::filesystem::path,hueentry_t>>() ;
+                if ((arg.paths.size()==2) && !std::filesystem::is_directory(arg.paths[1])){
+                    auto name = actionvalue.empty() ? arg.paths[1].stem().string() : actionvalue ;
+                    fitted.push_back(std::make_pair(arg.paths[1],fitRamp(image_t(arg.paths[1]),name)));
+                }
+                else {
+                    fitted = fitImages(std::vector<std::filesystem::path>(arg.paths.begin()+1,arg.paths.end())) ;
+                }
+                // A journal the user is keeping (from --edit) is left to them to checkpoint
+                auto journaled = std::filesystem::exists(huejournal_t::path(arg.paths[0])) ;
+                {
+                    // Through the journal, so edits already journaled stay in order with these
+                    auto journal = huejournal_t(arg.paths[0],maxhue) ;
+                    auto next = std::uint32_t(1) ;
+                    for (const auto &[path,entry]:fitted){
+                        auto id = freeId(journal.storage(),next) ;
+                        if (id < journal.storage().size()){
+                            journal.set(id,entry);
+                        }
+                        else {
+                            id = journal.append(entry) ;
+                        }
+                        next = id + 1 ;
+                        std::cout <<path.string()<<" fitted into id "<<id<<" ("<<entry.name()<<")"<<std::endl;
+                    }
+                    journal.commit();
+                }
+                if (!journaled){
+                    huejournal_t::checkpoint(arg.paths[0],maxhue);
+                }
+                break;
+            }
+            case action_t::select:{
+                if (arg.paths.empty()){
+                    throw std::runtime_error("No hue mul file specified");
+                }
+                if (!format.empty() && (format != "ids") && (format != "csv") && (format != "json")){
+                    throw std::runtime_error("Unknown select format: "s + format);
+                }
+                auto query = huequery_t(actionvalue) ;
+                auto hues = huestorage_t(arg.paths[0],maxhue) ;
+                writeSelection(hues,query.select(hues),format,std::cout);
+                break;
+            }
+            case action_t::split:{
+                if (arg.paths.size()<2) {
+                    throw std::runtime_error("Src hue mul path and Destination directory required.");
+                }
+                auto created = splitMul(arg.paths[0],parseRanges(actionvalue),arg.paths[1],maxhue) ;
+                for (const auto &path:created){
+                    reportCreated(path);
+                }
+                break;
+            }
+            case action_t::splice:{
+                if (arg.paths.size()<3) {
+                    throw std::runtime_error("Base hue mul path, part path(s) and Destination mul path required.");
+                }
+                auto parts = std::vector<huepart_t>() ;
+                for (size_t j = 1 ; j+1<arg.paths.size();j++){
+                    parts.push_back(parsePart(arg.paths[j].string()));
                 }
-                hues.save(arg.paths[0]);
-                std::cout <<arg.paths[0].string() <<" created"<<std::endl;
+                spliceMul(arg.paths[0],parts,arg.paths.back(),maxhue);
+                reportCreated(arg.paths.back());
                 break;
             }
         }
@@ -0,0 +1,58 @@
+//Copyright © 2022 Charles Kerr. All rights reserved.
+
+#ifndef parallel_hpp
+#define parallel_hpp
+
+#include <cstddef>
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <vector>
+
+//=======================================================================================================================
+// Splits [0,count) into contiguous chunks, one per hardware thread, and runs work(first,last,chunk)
+// on each chunk concurrently. The chunk number lets work reduce into per thread state without locking.
+// Returns the number of chunks used. If any chunk throws, the first exception is rethrown here.
+//=======================================================================================================================
+namespace parallel {
+    //=================================================================================
+    inline auto threads(std::size_t count) ->std::size_t {
+        auto available = static_cast<std::size_t>(std::max(1u,std::thread::hardware_concurrency())) ;
+        return std::max<std::size_t>(1,std::min(available,count)) ;
+    }
+    //=================================================================================
+    inline auto forEach(std::size_t count,const std::function<void(std::size_t,std::size_t,std::size_t)> &work) ->std::size_t {
+        auto chunks = threads(count) ;
+        if (chunks == 1){
+            work(0,count,0);
+            return chunks ;
+        }
+        auto errors = std::vector<std::exception_ptr>(chunks) ;
+        auto workers = std::vector<std::thread>() ;
+        workers.reserve(chunks);
+        for (std::size_t chunk = 0 ; chunk<chunks;chunk++){
+            auto first = (count*chunk)/chunks ;
+            auto last = (count*(chunk+1))/chunks ;
+            workers.emplace_back([&work,&errors,first,last,chunk](){
+                try {
+                    work(first,last,chunk);
+                }
+                catch (...){
+                    errors[chunk] = std::current_exception() ;
+                }
+            });
+        }
+        for (auto &worker:workers){
+            worker.join();
+        }
+        for (const auto &error:errors){
+            if (error){
+                std::rethrow_exception(error);
+            }
+        }
+        return chunks ;
+    }
+}
+
+#endif /* parallel_hpp */
@@ -9,11 +9,14 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <utility>
 
 #include <array>
 #include <charconv>
 #include <chrono>
+#include <cstddef>
+#include <iterator>
 #include <memory>
 #include <ostream>
 #include <system_error>
@@ -101,6 +104,46 @@ inline auto lower(const std::string &value) -> std::string {
     return rvalue;
 }
 
+//=========================================================
+// Quoting for output formats
+//=========================================================
+
+//=========================================================
+// The contents of a json string (without the quotes)
+inline auto escapeJSON(const std::string &value) -> std::string {
+    std::string rvalue;
+    for (const auto &ch : value) {
+        if ((ch == '"') || (ch == '\\')) {
+            rvalue += '\\';
+            rvalue += ch;
+        } else if (static_cast<unsigned char>(ch) < 0x20) {
+            constexpr auto digits = "0123456789abcdef";
+            rvalue += "\\u00";
+            rvalue += digits[(ch >> 4) & 0xf];
+            rvalue += digits[ch & 0xf];
+        } else {
+            rvalue += ch;
+        }
+    }
+    return rvalue;
+}
+//========================================================================
+// A csv field, quoted (with quotes doubled) only if it holds a comma, quote or line break
+inline auto quoteCSV(const std::string &value) -> std::string {
+    if (value.find_first_of(",\"\r\n") == std::string::npos) {
+        return value;
+    }
+    std::string rvalue = "\"";
+    for (const auto &ch : value) {
+        if (ch == '"') {
+            rvalue += '"';
+        }
+        rvalue += ch;
+    }
+    rvalue += '"';
+    return rvalue;
+}
+
 //=========================================================
 // String manipulation (remove remaining based on separator,
 // split, parse)
@@ -153,6 +196,122 @@ inline auto parse(const std::string &value, const std::string &sep)
     return rvalue;
 }
 
+//=========================================================
+// string_view utilities. These work on views of the original
+// string, so they do not allocate
+//=========================================================
+
+//=========================================================
+// Trim all whitespace from both sides of the view
+inline auto trim_view(std::string_view value) -> std::string_view {
+    auto loc = value.find_first_not_of(" \t\v\f\n\r");
+    if (loc == std::string_view::npos) {
+        return std::string_view();
+    }
+    value.remove_prefix(loc);
+    value.remove_suffix(value.size() - (value.find_last_not_of(" \t\v\f\n\r") + 1));
+    return value;
+}
+
+//=========================================================
+// Compare, ignoring case
+inline auto iequal(std::string_view lhs, std::string_view rhs) -> bool {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                      [](unsigned char a, unsigned char b) {
+                          return std::tolower(a) == std::tolower(b);
+                      });
+}
+
+//=========================================================
+// Same as split, but returns views into value
+inline auto split_view(std::string_view value, std::string_view sep)
+    -> std::pair<std::string_view, std::string_view> {
+    auto first = value;
+    auto second = std::string_view();
+    auto loc = value.find(sep);
+    if (loc != std::string_view::npos) {
+        first = trim_view(value.substr(0, loc));
+        loc = loc + sep.size();
+        if (loc < value.size()) {
+            second = trim_view(value.substr(loc));
+        }
+    }
+    return std::make_pair(first, second);
+}
+
+//=========================================================
+// Iterates over the trimmed fields of value, the same fields
+// parse would return, without allocating a vector of strings.
+//     for (auto field : strutil::tokenizer(line, ",")) {...}
+class tokenizer {
+    std::string_view value;
+    std::string_view sep;
+
+  public:
+    class iterator {
+        std::string_view value;
+        std::string_view sep;
+        std::string_view::size_type current;
+        std::string_view::size_type loc;
+
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view *;
+        using reference = std::string_view;
+
+        iterator(std::string_view value = std::string_view(),
+                 std::string_view sep = std::string_view(),
+                 std::string_view::size_type current = std::string_view::npos)
+            : value(value), sep(sep), current(current), loc(std::string_view::npos) {
+            if (this->current != std::string_view::npos) {
+                if (this->current >= value.size()) {
+                    this->current = std::string_view::npos;
+                } else {
+                    loc = value.find(sep, this->current);
+                }
+            }
+        }
+        auto operator*() const -> std::string_view {
+            if (loc == std::string_view::npos) {
+                return trim_view(value.substr(current));
+            }
+            return trim_view(value.substr(current, loc - current));
+        }
+        auto operator++() -> iterator & {
+            if (loc == std::string_view::npos) {
+                current = std::string_view::npos;
+            } else {
+                current = loc + sep.size();
+                if (current >= value.size()) {
+                    current = std::string_view::npos;
+                    loc = std::string_view::npos;
+                } else {
+                    loc = value.find(sep, current);
+                }
+            }
+            return *this;
+        }
+        auto operator++(int) -> iterator {
+            auto rvalue = *this;
+            ++(*this);
+            return rvalue;
+        }
+        auto operator==(const iterator &rhs) const -> bool {
+            return current == rhs.current;
+        }
+        auto operator!=(const iterator &rhs) const -> bool {
+            return current != rhs.current;
+        }
+    };
+
+    tokenizer(std::string_view value, std::string_view sep)
+        : value(value), sep(sep) {}
+    auto begin() const -> iterator { return iterator(value, sep, 0); }
+    auto end() const -> iterator { return iterator(); }
+};
+
 //=========================================================
 // Time/String conversions
 //=========================================================
@@ -360,6 +519,51 @@ ston(const std::string &str_value, radix_t radix = radix_t::dec) {
     return value;
 }
 
+//==========================================================
+// Convert a view to a number. Unlike the string version, this does not
+// throw, the error is returned (and value is unchanged on an error).
+// The entire view must be the number (an empty view is zero).
+template <typename T>
+auto ston(std::string_view str_value, T &value, radix_t radix = radix_t::dec)
+    -> typename std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, std::errc> {
+    if (str_value.empty()) {
+        value = T{0};
+        return std::errc();
+    }
+    if ((str_value.size() > 2) && (str_value[0] == '0') &&
+        std::isalpha(static_cast<unsigned char>(str_value[1]))) {
+        // This has a "radix indicator"
+        switch (str_value[1]) {
+        case 'b':
+        case 'B':
+            radix = radix_t::bin;
+            break;
+        case 'x':
+        case 'X':
+            radix = radix_t::hex;
+            break;
+        case 'o':
+        case 'O':
+            radix = radix_t::oct;
+            break;
+        default:
+            return std::errc::invalid_argument;
+        }
+        str_value.remove_prefix(2);
+    }
+    auto result = T{0};
+    auto [ptr, ec] = std::from_chars(str_value.data(), str_value.data() + str_value.size(),
+                                     result, static_cast<int>(radix));
+    if (ec != std::errc()) {
+        return ec;
+    }
+    if (ptr != str_value.data() + str_value.size()) {
+        return std::errc::invalid_argument;
+    }
+    value = result;
+    return std::errc();
+}
+
 //==========================================================
 // Convert a string to a bool
 template <typename T>